@@ -3,9 +3,19 @@
 
 #include "ccut.hh"
 
+#include <cstdlib>
+#include <new>
 #include <stdexcept>
 #include <string>
 
+#if __cplusplus >= 201103L
+#define CCUT_NOEXCEPT noexcept
+#define CCUT_THROWS_BAD_ALLOC
+#else
+#define CCUT_NOEXCEPT throw()
+#define CCUT_THROWS_BAD_ALLOC throw(std::bad_alloc)
+#endif
+
 // ----------------------------------------------------------------------------
 cut_result_t ccut_wrap_init(cut_init_func_t init, void* data, void* wrapper_cookie)
 {
@@ -117,3 +127,159 @@ struct Initializer
  * via the wrapper functions above.
  */
 Initializer g_ccut_initializer;
+
+#if CUT_ALLOC_HOOKS
+// ----------------------------------------------------------------------------
+// With the allocation hooks of cut.c in place (build both with
+// CUT_ALLOC_HOOKS defined as 1), every new and delete goes through malloc()
+// and free() so that a test's objects are counted with the rest of its
+// allocations, however the C++ runtime was built.
+// ----------------------------------------------------------------------------
+void* operator new(std::size_t size) CCUT_THROWS_BAD_ALLOC
+{
+  void* pointer = std::malloc((0 == size) ? 1 : size);
+
+  if (NULL == pointer)
+  {
+    throw std::bad_alloc();
+  }
+
+  return pointer;
+}   // operator new()
+
+// ----------------------------------------------------------------------------
+void* operator new[](std::size_t size) CCUT_THROWS_BAD_ALLOC
+{
+  return operator new(size);
+}   // operator new[]()
+
+// ----------------------------------------------------------------------------
+void* operator new(std::size_t size, const std::nothrow_t&) CCUT_NOEXCEPT
+{
+  return std::malloc((0 == size) ? 1 : size);
+}   // operator new()
+
+// ----------------------------------------------------------------------------
+void* operator new[](std::size_t size, const std::nothrow_t&) CCUT_NOEXCEPT
+{
+  return std::malloc((0 == size) ? 1 : size);
+}   // operator new[]()
+
+// ----------------------------------------------------------------------------
+void operator delete(void* pointer) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete()
+
+// ----------------------------------------------------------------------------
+void operator delete[](void* pointer) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete[]()
+
+// ----------------------------------------------------------------------------
+void operator delete(void* pointer, const std::nothrow_t&) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete()
+
+// ----------------------------------------------------------------------------
+void operator delete[](void* pointer, const std::nothrow_t&) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete[]()
+
+#if defined(__cpp_sized_deallocation)
+// ----------------------------------------------------------------------------
+void operator delete(void* pointer, std::size_t) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete()
+
+// ----------------------------------------------------------------------------
+void operator delete[](void* pointer, std::size_t) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete[]()
+#endif
+
+#if defined(__cpp_aligned_new)
+// ----------------------------------------------------------------------------
+// Over-aligned types (C++17) come from posix_memalign(), which cut.c counts
+// too, and go back through free().
+// ----------------------------------------------------------------------------
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) CCUT_NOEXCEPT
+{
+  std::size_t align = static_cast<std::size_t>(alignment);
+  void* pointer = NULL;
+
+  if (align < sizeof(void*))
+  {
+    align = sizeof(void*);
+  }
+
+  return (0 == posix_memalign(&pointer, align, (0 == size) ? 1 : size)) ? pointer : NULL;
+}   // operator new()
+
+// ----------------------------------------------------------------------------
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+  void* pointer = operator new(size, alignment, std::nothrow);
+
+  if (NULL == pointer)
+  {
+    throw std::bad_alloc();
+  }
+
+  return pointer;
+}   // operator new()
+
+// ----------------------------------------------------------------------------
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+  return operator new(size, alignment);
+}   // operator new[]()
+
+// ----------------------------------------------------------------------------
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) CCUT_NOEXCEPT
+{
+  return operator new(size, alignment, std::nothrow);
+}   // operator new[]()
+
+// ----------------------------------------------------------------------------
+void operator delete(void* pointer, std::align_val_t) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete()
+
+// ----------------------------------------------------------------------------
+void operator delete[](void* pointer, std::align_val_t) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete[]()
+
+// ----------------------------------------------------------------------------
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete()
+
+// ----------------------------------------------------------------------------
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete[]()
+
+// ----------------------------------------------------------------------------
+void operator delete(void* pointer, std::size_t, std::align_val_t) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete()
+
+// ----------------------------------------------------------------------------
+void operator delete[](void* pointer, std::size_t, std::align_val_t) CCUT_NOEXCEPT
+{
+  std::free(pointer);
+}   // operator delete[]()
+#endif
+#endif
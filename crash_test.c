@@ -0,0 +1,74 @@
+/* Copyright (c) 2003-2019 Doug Rogers under the Zero Clause BSD License. */
+/* You are free to do whatever you want with this software. See LICENSE.txt. */
+
+/*
+ * Tests that misbehave on purpose, to show what -isolate, -forkserver and
+ * time limits do with them. They are not run by 'make test'. Without
+ * isolation, spin stops the run and null_deref would take the whole program
+ * down, which is the point.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cut.h"
+
+static cut_result_t ok(void) {
+    CUT_ASSERT_INT(4, 2 + 2);
+    CUT_TEST_PASS();
+}
+
+static cut_result_t still_ok(void) {
+    CUT_ASSERT(strlen("crash") == 5);
+    CUT_TEST_PASS();
+}
+
+/* Never finishes; its 200 ms limit is set in crash_test() below. */
+static cut_result_t spin(void) {
+    volatile unsigned long count = 0;
+    for (;;) {
+        count++;
+    }
+    CUT_TEST_PASS();
+}
+
+static cut_result_t null_deref(void) {
+    volatile int* pointer = NULL;
+    *pointer = 1;
+    CUT_TEST_PASS();
+}
+
+void crash_test(void) {
+    CUT_ADD_TEST(ok);
+    CUT_ADD_TEST(still_ok);
+    CUT_ADD_TEST_TIMEOUT(spin, 200);
+    CUT_ADD_TEST(null_deref);
+}
+
+static void usage(FILE* f) {
+    fprintf(f, "\n");
+    fprintf(f, "Usage: crash_test [test-substring...]\n");
+    fprintf(f, "\n");
+    fprintf(f, "  -h, -help                     Print this usage information.\n");
+    fprintf(f, "\n");
+    cut_usage(f);
+}
+
+int main(int argc, char* argv[]) {
+    int i = 0;
+    cut_parse_command_line(&argc, argv);
+    CUT_INSTALL_SUITE(crash_test);
+    for (i = 1; i < argc; ++i) {
+        if ((0 == strcmp(argv[i], "-h")) || (0 == strcmp(argv[i], "-help"))) {
+            usage(stdout);
+            return 0;
+        } else {
+            if (!cut_include_test(argv[i])) {
+                fprintf(stderr, "crash_test: no test names match '%s'\n", argv[i]);
+                fprintf(stderr, "crash_test: use -h for usage information\n");
+                return 1;
+            }
+        }
+    }
+    return cut_run(1);
+}
@@ -1,6 +1,10 @@
 /* Copyright (c) 2003-2019 Doug Rogers under the Zero Clause BSD License. */
 /* You are free to do whatever you want with this software. See LICENSE.txt. */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE   /* For RUSAGE_THREAD. */
+#endif
+
 #include "cut.h"
 
 #if defined(_WIN32)
@@ -15,9 +19,26 @@
 #include <stdlib.h>
 #include <string.h>
 #if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/resource.h>
 #include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 #include <time.h>
+#if CUT_ALLOC_HOOKS
+#include <execinfo.h>
+#include <malloc.h>
+#endif
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 
 #if defined(GNUC)
 #define FIELD(_name)   ._name =
@@ -29,7 +50,7 @@
 #define snprintf(_s,_n,...)         _snprintf_s(_s, _n, _TRUNCATE, __VA_ARGS__)
 #define vsnprintf(_s,_n,_fmt,_va)   vsnprintf_s(_s, _n, _TRUNCATE, _fmt, _va)
 #define strncpy(_d,_s,_n)           strncpy_s(_d,_n,_s,_TRUNCATE)
-#define strcasecmp(_s1,_s2)         _strnicmp(_s1, _s2, CUT_NAME_LEN_MAX)
+#define strncasecmp(_s1,_s2,_n)     _strnicmp(_s1, _s2, _n)
 typedef          __int32  int32_t;
 typedef unsigned __int32 uint32_t;
 typedef          __int64  int64_t;
@@ -41,6 +62,20 @@ typedef unsigned __int64 uint64_t;
  */
 typedef uint64_t usec_t;
 
+/**
+ * Resources used by the running thread (or process), as reported by
+ * cut_get_resources(); times are in nanoseconds.
+ */
+typedef struct cut_resources_s
+{
+  uint64_t user_nsec;
+  uint64_t sys_nsec;
+  uint64_t voluntary_switches;
+  uint64_t involuntary_switches;
+  uint64_t minor_faults;
+  uint64_t major_faults;
+} cut_resources_t;
+
 /**
  * Text name of result.
  */
@@ -87,10 +122,103 @@ int cut_print_case_flags = CUT_FLAG_FAIL | CUT_FLAG_ERROR;
 int cut_print_init_cases = CUT_PRINT_INIT_CASES_DEFAULT;
 
 /**
- * Maximum length of a suite or test name. Note that the test name includes
- * the suite name, so suites must actually be shorter.
+ * Set to print the resources used by each test.
+ */
+int cut_print_resources = CUT_PRINT_RESOURCES_DEFAULT;
+
+/**
+ * Set to count hardware events in each test.
+ */
+int cut_perf_counters = CUT_PERF_COUNTERS_DEFAULT;
+
+/**
+ * Set to count the heap allocations of each test.
+ */
+int cut_track_allocations = CUT_TRACK_ALLOCATIONS_DEFAULT;
+
+/**
+ * Number of worker threads used by cut_run(). A value of 1 runs the tests
+ * serially on the calling thread; 0 uses one thread per CPU.
+ */
+int cut_jobs = CUT_JOBS_DEFAULT;
+
+/**
+ * Set this to run each test in its own child process.
+ */
+int cut_isolate = CUT_ISOLATE_DEFAULT;
+
+/**
+ * Set this to run each test in its own child process, forked from a
+ * forkserver started when cut_run() is called.
+ */
+int cut_forkserver = CUT_FORKSERVER_DEFAULT;
+
+/**
+ * File in which test durations are kept from one run to the next, or NULL
+ * to keep no history.
+ */
+const char* cut_history_file = NULL;
+
+/**
+ * Set to run the tests that failed last time first, or only those tests.
+ */
+int cut_failed_first = CUT_FAILED_FIRST_DEFAULT;
+int cut_failed_only = CUT_FAILED_ONLY_DEFAULT;
+
+/**
+ * Time limit for each test in milliseconds, or 0 for none.
  */
-#define CUT_NAME_LEN_MAX  0x100
+int cut_timeout_msec = CUT_TIMEOUT_DEFAULT;
+
+/**
+ * Set to profile assertion sites.
+ */
+int cut_profile_assertions = CUT_PROFILE_ASSERTIONS_DEFAULT;
+
+/**
+ * Set to measure benchmarks, with the least time of each timed run and how
+ * many runs to time.
+ */
+int cut_benchmark = CUT_BENCHMARK_DEFAULT;
+int cut_benchmark_msec = CUT_BENCHMARK_MSEC_DEFAULT;
+int cut_benchmark_runs = CUT_BENCHMARK_RUNS_DEFAULT;
+
+/**
+ * Files from which benchmark runs are read for comparison and to which they
+ * are written, or NULL, and how much slower than its baseline a benchmark
+ * may be, in percent.
+ */
+const char* cut_benchmark_baseline = NULL;
+const char* cut_benchmark_save = NULL;
+int cut_benchmark_threshold = CUT_BENCHMARK_THRESHOLD_DEFAULT;
+
+/**
+ * Thread counts of scaling benchmarks, or NULL for the default.
+ */
+const char* cut_benchmark_threads = NULL;
+
+/**
+ * The shard of the tests to run, and how many shards they are split into.
+ */
+int cut_shard_index = 0;
+int cut_shard_count = 1;
+
+/**
+ * Size of each block of the name pool. Longer names get a block of their
+ * own.
+ */
+#define CUT_NAME_CHUNK_SIZE  0x10000
+
+/*
+ * Types of the threading layer below, which the suites need as well.
+ */
+#if defined(_WIN32)
+typedef CRITICAL_SECTION  cut_mutex_t;
+typedef CONDITION_VARIABLE cut_cond_t;
+#else
+typedef pthread_mutex_t   cut_mutex_t;
+typedef pthread_cond_t    cut_cond_t;
+#endif
 
 typedef struct cut_test_s  cut_test_t;
 typedef struct cut_suite_s cut_suite_t;
@@ -102,14 +230,171 @@ typedef struct cut_suite_s cut_suite_t;
 #define CUT_TEST_FLAG_EXCLUDE   0x0001
 
 /**
- * Test type.
+ * Flag for a test whose duration was read from the history file.
+ */
+#define CUT_TEST_FLAG_HISTORY   0x0002
+
+/**
+ * Flag for a test whose duration was measured in this run.
+ */
+#define CUT_TEST_FLAG_TIMED     0x0004
+
+/**
+ * Flag for a test that belongs to another shard. It is neither run nor
+ * reported.
+ */
+#define CUT_TEST_FLAG_OTHER_SHARD 0x0008
+
+/**
+ * Flag for a test whose result is known, from this run or the history file.
+ */
+#define CUT_TEST_FLAG_RESULT    0x0010
+
+/**
+ * Flag for a benchmark, which is run through its benchmark_func.
+ */
+#define CUT_TEST_FLAG_BENCHMARK 0x0020
+
+/**
+ * Flag for a benchmark that is measured at several thread counts.
+ */
+#define CUT_TEST_FLAG_SCALING   0x0040
+
+/**
+ * States of a suite's once-per-suite setup.
+ */
+#define CUT_SUITE_IDLE          0   /**< Not set up. */
+#define CUT_SUITE_READY         1   /**< Setup passed; tests may run. */
+#define CUT_SUITE_FAILED        2   /**< Setup failed; tests are ERRORs. */
+#define CUT_SUITE_BUSY          3   /**< Setup or teardown is running. */
+
+/**
+ * @return non-zero if suite @a _s has work to do before its first test or
+ * after its last.
+ */
+#define CUT_SUITE_HAS_ONCE(_s)  ((NULL != (_s)->setup) || (NULL != (_s)->teardown) || (NULL != (_s)->snapshot))
+
+/**
+ * Longest time the watchdog sleeps between checks of the running tests.
+ */
+#define CUT_WATCHDOG_USEC       10000
+
+/**
+ * Number of sites listed for each test by -profile-assertions.
+ */
+#define CUT_PROFILE_TOP         5
+
+/**
+ * Hardware events counted with -perf-counters, and the phases of a test
+ * that they are counted in.
+ */
+#define CUT_PERF_CYCLES         0
+#define CUT_PERF_INSTRUCTIONS   1
+#define CUT_PERF_BRANCH_MISSES  2
+#define CUT_PERF_L1D_MISSES     3
+#define CUT_PERF_LLC_MISSES     4
+#define CUT_PERF_COUNT          5
+
+#define CUT_PERF_INIT           0   /**< Suite setup and the init function. */
+#define CUT_PERF_TEST           1   /**< The test function. */
+#define CUT_PERF_EXIT           2   /**< The exit function and suite teardown. */
+#define CUT_PERF_PHASES         3
+
+/**
+ * A block allocated by the running test that it has not yet freed.
+ */
+typedef struct cut_alloc_block_s
+{
+  void* pointer;
+  size_t size;
+} cut_alloc_block_t;
+
+/**
+ * Heap use of the running test, as seen by the allocation hooks.
+ */
+typedef struct cut_alloc_stats_s
+{
+  /**
+   * Number of allocations, and the bytes they asked for.
+   */
+  uint64_t count;
+  uint64_t bytes;
+
+  /**
+   * Blocks allocated and not yet freed, their bytes, and the most bytes
+   * live at once.
+   */
+  uint64_t live_count;
+  uint64_t live_bytes;
+  uint64_t peak_bytes;
+
+  /**
+   * The live blocks, in a hash table of live_size (a power of 2) slots
+   * with linear probing, so that frees of blocks the test did not allocate
+   * are told apart.
+   */
+  cut_alloc_block_t* live;
+  size_t live_size;
+} cut_alloc_stats_t;
+
+/**
+ * An allocation budget of CUT_ASSERT_ALLOCS_LE() and the like: the limits,
+ * what the code has used so far, and the return address and size of the
+ * first allocation that went past a limit.
+ */
+typedef struct cut_alloc_region_s
+{
+  unsigned long long max_count;
+  unsigned long long max_bytes;
+  unsigned long long count;
+  unsigned long long bytes;
+  void* first_over;
+  size_t first_over_size;
+} cut_alloc_region_t;
+
+/**
+ * Most allocation budgets open at once on one thread.
+ */
+#define CUT_ALLOC_REGION_DEPTH  8
+
+/**
+ * Most iterations a benchmark's count is calibrated up to, and the most the
+ * count grows by from one calibration run to the next.
+ */
+#define CUT_BENCHMARK_MAX_ITERATIONS  1000000000
+#define CUT_BENCHMARK_MAX_GROWTH      100
+
+/**
+ * Significance level at which a benchmark slower than its baseline fails.
+ */
+#define CUT_BENCHMARK_ALPHA           0.05
+
+/**
+ * Most values of either side the Mann-Whitney test uses; above this the
+ * counts of its exact distribution no longer fit in a double.
+ */
+#define CUT_BENCHMARK_MAX_TEST_RUNS   200
+
+/**
+ * Most thread counts a scaling benchmark is measured at, and the most
+ * threads in any of them.
+ */
+#define CUT_BENCHMARK_MAX_COUNTS      16
+#define CUT_BENCHMARK_MAX_THREADS     1024
+
+/**
+ * Test type. Tests are kept in registration order in one array, g_cut->test,
+ * with the tests of each suite next to each other. Only what the run needs
+ * is kept here; the names are in the parallel array g_cut->test_name.
  */
 struct cut_test_s
 {
   /**
-   * The name includes the suite name ("suite.test").
+   * Test function. For a benchmark this is cut_run_benchmark(), which runs
+   * benchmark_func.
    */
-  char name[CUT_NAME_LEN_MAX];
+  cut_test_func_t func;
+  cut_benchmark_func_t benchmark_func;
 
   /**
    * Flags for this test, a bitwise OR of CUT_TEST_FLAG_xxx.
@@ -117,19 +402,30 @@ struct cut_test_s
   int flags;
 
   /**
-   * Test function.
+   * Index of the parent suite in g_cut->suite.
    */
-  cut_test_func_t func;
+  uint32_t suite;
 
   /**
-   * Parent suite.
+   * Duration of the test, from this run (CUT_TEST_FLAG_TIMED) or from the
+   * history file (CUT_TEST_FLAG_HISTORY).
    */
-  cut_suite_t* suite;
+  usec_t usec;
+
+  /**
+   * Expected duration, used to schedule parallel runs.
+   */
+  usec_t expected_usec;
+
+  /**
+   * Time limit for this test in milliseconds, or 0 to use the suite's.
+   */
+  unsigned timeout_msec;
 
   /**
-   * Next test in list, or NULL if the current test is the last.
+   * Result of the test's last run, if CUT_TEST_FLAG_RESULT is set.
    */
-  cut_test_t* next;
+  cut_result_t result;
 
 };  /* struct cut_test_s */
 
@@ -139,9 +435,32 @@ struct cut_test_s
 struct cut_suite_s
 {
   /**
-   * The name includes the suite name ("suite.test").
+   * The suite's name, shortened if cut_shorten_names is set, and the same
+   * followed by cut_name_delimiter, which begins the full name of each of
+   * its tests. Both are in the name pool.
+   */
+  const char* name;
+  const char* prefix;
+  size_t prefix_length;
+
+  /**
+   * Index in g_cut->test of the suite's first test, and how many it has.
    */
-  char name[CUT_NAME_LEN_MAX];
+  size_t first;
+  size_t count;
+
+  /**
+   * The suite's installer while it has not yet been called; NULL once it
+   * has. See cut_install_pending().
+   */
+  cut_install_func_t install;
+
+  /**
+   * For a suite of CUT_TEST()s, the index in the cut_t static_list of its
+   * first test, and how many it has.
+   */
+  size_t static_first;
+  size_t static_count;
 
   /**
    * Number of data bytes to send.
@@ -153,6 +472,11 @@ struct cut_suite_s
    */
   void* data;
 
+  /**
+   * Time limit for each test in milliseconds, or 0 to use cut_timeout_msec.
+   */
+  unsigned timeout_msec;
+
   /**
    * Initialization function for each test in suite.
    */
@@ -164,28 +488,122 @@ struct cut_suite_s
   cut_exit_func_t exit;
 
   /**
-   * Linked list of tests.
+   * In snapshot mode, the buffer that init() fills once and that is copied
+   * into each test's data buffer; NULL otherwise.
    */
-  cut_test_t* test;
+  void* snapshot;
+
+  /**
+   * Setup and teardown run once around the suite's tests, and the buffer of
+   * shared_size bytes that they (and the tests, through cut_suite_data())
+   * share.
+   */
+  cut_init_func_t setup;
+  cut_exit_func_t teardown;
+  void* shared;
+  size_t shared_size;
 
   /**
-   * Next suite in list.
+   * Whether the setup has run and passed (a CUT_SUITE_xxx value), and how
+   * many of the suite's tests in this run are still to finish. Protected by
+   * the cut_t suite_lock, which is not held while the setup or teardown
+   * runs; workers that need the suite while it is CUT_SUITE_BUSY wait on
+   * @a changed instead, which is only initialized for a suite with
+   * once-per-suite work.
    */
-  cut_suite_t* next;
+  int state;
+  size_t pending;
+  cut_cond_t changed;
 };   /* struct cut_suite_s */
 
 /**
- * Global cut object, just in case I want to objectify it some day. The whole
- * point of this exercise was to simplify my existing unit test framework to
- * get rid of all that, but I can't seem to resist this concession.
+ * Block of the name pool. Names are never moved or freed, so pointers to
+ * them stay valid.
  */
-typedef struct cut_s
+typedef struct cut_chunk_s
+{
+  struct cut_chunk_s* next;
+  size_t used;
+  size_t size;
+  char text[1];
+} cut_chunk_t;
+
+/* ------------------------------------------------------------------------- */
+/*
+ * Minimal threading layer used by the parallel runner. Only what cut needs is
+ * provided: threads that run a single function, a mutex, a condition
+ * variable, and a barrier.
+ */
+typedef void (*cut_thread_func_t)(void* arg);
+
+/**
+ * Thread type. The function and argument are kept here so that no
+ * allocation is needed to start a thread; the object must outlive the
+ * thread.
+ */
+typedef struct cut_thread_s
+{
+#if defined(_WIN32)
+  HANDLE handle;
+#else
+  pthread_t handle;
+#endif
+  cut_thread_func_t func;
+  void* arg;
+} cut_thread_t;
+
+/**
+ * Barrier at which @a count threads wait for each other. It may be used
+ * again once all have passed; @a generation tells one use from the next.
+ */
+typedef struct cut_barrier_s
+{
+  cut_mutex_t lock;
+  cut_cond_t cond;
+  int count;
+  int waiting;
+  unsigned generation;
+} cut_barrier_t;
+
+/**
+ * Assertions made at one file:line site in one test, for
+ * -profile-assertions.
+ */
+typedef struct cut_site_count_s
 {
   /**
-   * List of suites.
+   * Site and test; file is NULL for an empty slot of a table.
    */
-  cut_suite_t* suite;
+  const char* file;
+  int line;
+  const cut_test_t* test;
+
+  /**
+   * Number of assertions with each result, and the time spent since the
+   * test's previous assertion summed over them.
+   */
+  unsigned int count[CUT_RESULT_COUNT];
+  uint64_t usec;
+} cut_site_count_t;
 
+/**
+ * Hash table of site counts, keyed by the address of the file name, the
+ * line and the test. It has size slots, a power of 2, count of them used.
+ */
+typedef struct cut_site_table_s
+{
+  cut_site_count_t* slot;
+  size_t size;
+  size_t count;
+} cut_site_table_t;
+
+/**
+ * Per-thread state for running tests. The serial runner uses a single
+ * worker; the parallel runner uses one per thread so that no test state is
+ * shared between threads.
+ */
+typedef struct cut_worker_s
+{
   /**
    * Suite currently in use.
    */
@@ -206,6 +624,14 @@ typedef struct cut_s
    */
   unsigned int tests[CUT_RESULT_COUNT];
 
+  /**
+   * The counts above as of the worker's last finished test, for the summary
+   * printed when a timeout stops the run. Protected by the cut_t lock while
+   * tests are watched.
+   */
+  unsigned int done_assertions[CUT_RESULT_COUNT];
+  unsigned int done_tests[CUT_RESULT_COUNT];
+
   /**
    * Set when the test name is printed in order to track when to add
    * newlines.
@@ -213,985 +639,7932 @@ typedef struct cut_s
   int test_name_hanging;
 
   /**
-   * Set when a call is made to cut_include_test() is called. Until that
-   * point, all tests are included.
+   * Private copy of the suite data buffer, or NULL to use the suite's own
+   * buffer (serial runs).
    */
-  int include_test_called;
-} cut_t;
+  void* data;
 
-/**
- * Global (singleton) C unit test object.
- */
-static cut_t g_cut_info =
-{
-  FIELD(suite)              NULL,
-  FIELD(active_suite)       NULL,
-  FIELD(active_test)        NULL,
-  FIELD(assertions)         { 0, 0, 0, 0 },
-  FIELD(tests)              { 0, 0, 0, 0 },
-  FIELD(test_name_hanging)  0,
-  FIELD(include_test_called) 0
-};   /* g_cut_info */
+  /**
+   * Size of the allocation at @a data.
+   */
+  size_t data_size;
 
-/**
- * Pointer to global C unit test object.
- */
-static cut_t* g_cut = &g_cut_info;
+  /**
+   * When set, output is collected in @a out and printed as a unit once the
+   * test completes so that lines from different workers do not interleave.
+   */
+  int buffered;
 
-/**
- * Maximum length of character image function.
- */
-#define CHAR_IMAGE_MAX_LEN 8
+  /**
+   * Output buffer, its length and allocated size.
+   */
+  char* out;
+  size_t out_len;
+  size_t out_size;
 
-/**
- * Maximum length of a string to be printed when a mismatch is detected. This
- * should be used by all strings passed to printable_diff_string().
- */
-#define PRINTABLE_DIFF_STRING_MAX_LEN  64
+  /**
+   * When set, buffered output is sent to the parent process over
+   * @a report_fd instead of being printed (isolated runs only).
+   */
+  int report;
+  int report_fd;
 
-/* ------------------------------------------------------------------------- */
-/**
- * @return a monotonically increasing time in microseconds since the first
- * call.
- */
-static uint64_t usec_time(void)
-{
-    static int started = 0;
-#if defined(_WIN32)
-    FILETIME       ftime;
-    ULARGE_INTEGER ul;
-    static ULARGE_INTEGER start = {0};
-    GetSystemTimeAsFileTime(&ftime);
-    ul.LowPart  = ftime.dwLowDateTime;
-    ul.HighPart = ftime.dwHighDateTime;
-    if (!started) {
-        started = 1;
-        start = ul;
-    }
-    ul.QuadPart -= start.QuadPart;
-    return ul.QuadPart / 10;
-#else
-    struct timeval tv = { 0, 0 };
-    static uint64_t start = 0;
-    uint64_t now;
-    gettimeofday(&tv, NULL);
-    now = (uint64_t) tv.tv_sec;
-    now = (1000000 * now) + tv.tv_usec;
-    if (!started) {
-        started = 1;
-        start = now;
-    }
-    now -= start;
-    return now;
-#endif
-}   /* usec_time() */
+  /**
+   * Thread running this worker (parallel runs only).
+   */
+  cut_thread_t thread;
 
-/* ------------------------------------------------------------------------- */
-/**
- * @param c - the character whose image is sought.
- *
- * @param image - buffer to hold the image, or NULL for a shared buffer. This
- * must point to a buffer of at least CHAR_IMAGE_MAX_LEN characters.
- *
+  /**
+   * Test being watched for a timeout, when it started and when its time is
+   * up, or NULL. Protected by the cut_t lock.
+   */
+  cut_test_t* watch_test;
+  usec_t watch_start;
+  usec_t watch_deadline;
+  struct tm watch_stamp;
+
+  /**
+   * Assertion sites seen by this worker, and the time of the running
+   * test's last assertion (-profile-assertions only).
+   */
+  cut_site_table_t sites;
+  usec_t site_time;
+
+  /**
+   * Statistics of the benchmark just measured, in nanoseconds per
+   * iteration, and the number of runs of bench_iterations each that they
+   * came from. bench_runs is 0 if nothing was measured.
+   */
+  double bench_median;
+  double bench_min;
+  double bench_mad;
+  size_t bench_iterations;
+  int bench_runs;
+
+  /**
+   * The runs themselves in nanoseconds per iteration, sorted, while they
+   * are to be saved (see cut_bench_keep()); otherwise NULL.
+   */
+  double* bench_nsec;
+
+  /**
+   * When set, the change in the benchmark's median from its baseline and
+   * the p-value of the test of whether it is slower than the threshold.
+   */
+  int bench_compared;
+  double bench_change;
+  double bench_p;
+
+  /**
+   * Hardware event counters of this worker's thread: 0 until they are
+   * opened, 1 once open, -1 if none could be. A counter that could not be
+   * opened has a descriptor of -1.
+   */
+  int perf_state;
+  int perf_fd[CUT_PERF_COUNT];
+
+  /**
+   * Counts at the end of the last phase, the counts of each phase of the
+   * running test, and their totals over this worker's tests, with a bit
+   * (1 << CUT_PERF_xxx) for each event in the totals.
+   */
+  uint64_t perf_mark[CUT_PERF_COUNT];
+  uint64_t perf_test[CUT_PERF_PHASES][CUT_PERF_COUNT];
+  uint64_t perf_total[CUT_PERF_PHASES][CUT_PERF_COUNT];
+  unsigned perf_have;
+
+  /**
+   * Counts per iteration over a benchmark's timed runs; bench_perf_have is
+   * set if they were taken.
+   */
+  double bench_perf[CUT_PERF_COUNT];
+  int bench_perf_have;
+
+  /**
+   * Thread counts of the scaling benchmark just measured and the operations
+   * per second at each; bench_scaling is how many were measured.
+   */
+  int bench_threads[CUT_BENCHMARK_MAX_COUNTS];
+  double bench_ops[CUT_BENCHMARK_MAX_COUNTS];
+  int bench_scaling;
+
+  /**
+   * Heap allocations of the running test, and whether they were counted
+   * (-track-allocations only).
+   */
+  cut_alloc_stats_t allocs;
+  int allocs_tracked;
+} cut_worker_t;
+
+/**
+ * Global cut object, just in case I want to objectify it some day. The whole
+ * point of this exercise was to simplify my existing unit test framework to
+ * get rid of all that, but I can't seem to resist this concession.
+ */
+typedef struct cut_s
+{
+  /**
+   * Array of suite_count suites, in the order they were installed, with
+   * room for suite_size.
+   */
+  cut_suite_t* suite;
+  size_t suite_count;
+  size_t suite_size;
+
+  /**
+   * Array of test_count tests, in the order they were added, with room for
+   * test_size, and the array of their names, with room for test_name_size.
+   * Each name is in the name pool and leaves out the suite's prefix.
+   */
+  cut_test_t* test;
+  const char** test_name;
+  size_t test_count;
+  size_t test_size;
+  size_t test_name_size;
+
+  /**
+   * Suite currently being installed.
+   */
+  cut_suite_t* active_suite;
+
+  /**
+   * The name pool: the blocks holding the names, newest first, and a hash
+   * table of name_table_size entries with the name_count names stored, so
+   * that each distinct name is stored once.
+   */
+  cut_chunk_t* names;
+  const char** name_table;
+  size_t name_table_size;
+  size_t name_count;
+
+  /**
+   * Number of assertions made with each type of result, summed over all
+   * workers.
+   */
+  unsigned int assertions[CUT_RESULT_COUNT];
+
+  /**
+   * Number of tests finished with each type of result, summed over all
+   * workers.
+   */
+  unsigned int tests[CUT_RESULT_COUNT];
+
+  /**
+   * Set when a call is made to cut_include_test() is called. Until that
+   * point, all tests are included.
+   */
+  int include_test_called;
+
+  /**
+   * Tests to be run by cut_run(), in order.
+   */
+  cut_test_t** run;
+
+  /**
+   * Number of tests in @a run.
+   */
+  size_t run_count;
+
+  /**
+   * Index of the next test in @a run to be handed to a worker.
+   */
+  size_t run_next;
+
+  /**
+   * Protects @a run_next and stdout during parallel runs.
+   */
+  cut_mutex_t lock;
+
+  /**
+   * Program name, from cut_parse_command_line().
+   */
+  const char* program;
+
+  /**
+   * Guards the state of each suite's once-per-suite setup and teardown; it is
+   * only held to change that state, not while they run.
+   */
+  cut_mutex_t suite_lock;
+
+  /**
+   * Parallel workers, for the watchdog; the main worker is not included.
+   */
+  cut_worker_t* workers;
+  int worker_count;
+
+  /**
+   * Set while the watchdog thread is running, and set to stop it.
+   */
+  int watching;
+  int watchdog_stop;
+  cut_thread_t watchdog;
+
+  /**
+   * Set if the run prints a summary, which a timeout prints before it
+   * stops the run.
+   */
+  int print_summary;
+
+  /**
+   * Lines of the history file for tests that are not registered, kept so
+   * that they are written back unchanged.
+   */
+  char* history_extra;
+  size_t history_extra_len;
+
+  /**
+   * Patterns given with -exclude, applied when cut_run() is called.
+   */
+  const char** exclude;
+  size_t exclude_count;
+  size_t exclude_size;
+
+  /**
+   * Static tests registered by constructors, most recent first.
+   */
+  cut_static_link_t* static_tests;
+
+  /**
+   * Set once the suites of the static tests have been added, and those
+   * static_count tests in the order they are installed in.
+   */
+  int static_installed;
+  const cut_static_test_t** static_list;
+  size_t static_count;
+
+  /**
+   * Assertion sites of all workers, merged as they finish.
+   */
+  cut_site_table_t sites;
+
+  /**
+   * One entry per test, indexed as g_cut->test, while benchmarks are
+   * compared with a baseline or saved; NULL otherwise.
+   */
+  struct cut_bench_runs_s* bench;
+
+  /**
+   * Totals of the hardware event counts of each phase over all tests, and
+   * a bit for each event counted (-perf-counters only).
+   */
+  uint64_t perf_total[CUT_PERF_PHASES][CUT_PERF_COUNT];
+  unsigned perf_have;
+} cut_t;
+
+/**
+ * Global (singleton) C unit test object.
+ */
+static cut_t g_cut_info =
+{
+  FIELD(suite)              NULL,
+  FIELD(suite_count)        0,
+  FIELD(suite_size)         0,
+  FIELD(test)               NULL,
+  FIELD(test_name)          NULL,
+  FIELD(test_count)         0,
+  FIELD(test_size)          0,
+  FIELD(test_name_size)     0,
+  FIELD(active_suite)       NULL,
+  FIELD(names)              NULL,
+  FIELD(name_table)         NULL,
+  FIELD(name_table_size)    0,
+  FIELD(name_count)         0,
+  FIELD(assertions)         { 0, 0, 0, 0 },
+  FIELD(tests)              { 0, 0, 0, 0 },
+  FIELD(include_test_called) 0
+};   /* g_cut_info */
+
+/**
+ * Pointer to global C unit test object.
+ */
+static cut_t* g_cut = &g_cut_info;
+
+/**
+ * Worker used by the serial runner and by any thread not started by cut.
+ */
+static cut_worker_t g_cut_main_worker;
+
+/**
+ * Worker for the current thread.
+ */
+static CUT_THREAD_LOCAL cut_worker_t* g_cut_worker = &g_cut_main_worker;
+
+/**
+ * Where the allocation hooks count the allocations of this thread, or NULL
+ * while they are not being counted.
+ */
+static CUT_THREAD_LOCAL cut_alloc_stats_t* g_cut_allocs = NULL;
+
+/**
+ * Allocation budgets open on this thread. They are kept here rather than
+ * on the test's stack so that a test leaving one open, by returning from
+ * an assertion or throwing from within it, leaves nothing dangling.
+ */
+static CUT_THREAD_LOCAL cut_alloc_region_t g_cut_alloc_region[CUT_ALLOC_REGION_DEPTH];
+static CUT_THREAD_LOCAL int g_cut_alloc_depth = 0;
+
+/**
+ * Maximum length of character image function.
+ */
+#define CHAR_IMAGE_MAX_LEN 8
+
+/**
+ * Maximum length of a string to be printed when a mismatch is detected. This
+ * should be used by all strings passed to printable_diff_string().
+ */
+#define PRINTABLE_DIFF_STRING_MAX_LEN  64
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return a monotonic time in nanoseconds since the first call.
+ */
+static uint64_t nsec_time(void)
+{
+    static int started = 0;
+#if defined(_WIN32)
+    static LARGE_INTEGER start = {0};
+    static LARGE_INTEGER frequency = {0};
+    LARGE_INTEGER now;
+    uint64_t ticks;
+    QueryPerformanceCounter(&now);
+    if (!started) {
+        started = 1;
+        QueryPerformanceFrequency(&frequency);
+        start = now;
+    }
+    ticks = (uint64_t) (now.QuadPart - start.QuadPart);
+    return (ticks / frequency.QuadPart) * 1000000000 +
+           ((ticks % frequency.QuadPart) * 1000000000) / frequency.QuadPart;
+#else
+    struct timespec ts = { 0, 0 };
+    static uint64_t start = 0;
+    uint64_t now;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t) ts.tv_sec;
+    now = (1000000000 * now) + ts.tv_nsec;
+    if (!started) {
+        started = 1;
+        start = now;
+    }
+    now -= start;
+    return now;
+#endif
+}   /* nsec_time() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return a monotonically increasing time in microseconds since the first
+ * call.
+ */
+static uint64_t usec_time(void)
+{
+    return nsec_time() / 1000;
+}   /* usec_time() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Fills in @a resources with the totals used so far by the calling thread,
+ * or by the whole process where per-thread counts are not available.
+ */
+static void cut_get_resources(cut_resources_t* resources)
+{
+#if defined(_WIN32)
+  FILETIME creation;
+  FILETIME exit;
+  FILETIME kernel;
+  FILETIME user;
+
+  memset(resources, 0, sizeof(*resources));
+
+  if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+  {
+    resources->user_nsec = ((((uint64_t) user.dwHighDateTime) << 32) | user.dwLowDateTime) * 100;
+    resources->sys_nsec = ((((uint64_t) kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime) * 100;
+  }
+#else
+  struct rusage usage;
+
+  memset(resources, 0, sizeof(*resources));
+  memset(&usage, 0, sizeof(usage));
+
+#if defined(RUSAGE_THREAD)
+  if (0 != getrusage(RUSAGE_THREAD, &usage))
+#endif
+  {
+    getrusage(RUSAGE_SELF, &usage);
+  }
+
+  resources->user_nsec = (uint64_t) usage.ru_utime.tv_sec * 1000000000 + (uint64_t) usage.ru_utime.tv_usec * 1000;
+  resources->sys_nsec = (uint64_t) usage.ru_stime.tv_sec * 1000000000 + (uint64_t) usage.ru_stime.tv_usec * 1000;
+  resources->voluntary_switches = (uint64_t) usage.ru_nvcsw;
+  resources->involuntary_switches = (uint64_t) usage.ru_nivcsw;
+  resources->minor_faults = (uint64_t) usage.ru_minflt;
+  resources->major_faults = (uint64_t) usage.ru_majflt;
+#endif
+}   /* cut_get_resources() */
+
+/**
+ * Names of the hardware events, indexed by CUT_PERF_xxx.
+ */
+static const char* cut_perf_name[CUT_PERF_COUNT] =
+{
+  "cycles",
+  "instructions",
+  "branch-misses",
+  "L1d-misses",
+  "LLC-misses"
+};
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Opens the hardware event counters for the calling thread into @a fd, each
+ * entry -1 if that counter could not be opened.
+ *
+ * @return 0 if at least one counter is open, otherwise the error of the
+ * first that failed.
+ */
+static int cut_perf_open_counters(int* fd)
+{
+#if defined(__linux__)
+  static const struct { uint32_t type; uint64_t config; } event[CUT_PERF_COUNT] =
+  {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+  };
+  int error = 0;
+  int opened = 0;
+  int i = 0;
+
+  for (i = 0; i < CUT_PERF_COUNT; i++)
+  {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event[i].type;
+    attr.config = event[i].config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd[i] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+
+    if (fd[i] >= 0)
+    {
+      opened = 1;
+    }
+    else if (0 == error)
+    {
+      error = errno;
+    }
+  }
+
+  return opened ? 0 : error;
+#else
+  int i = 0;
+
+  for (i = 0; i < CUT_PERF_COUNT; i++)
+  {
+    fd[i] = -1;
+  }
+
+  return ENOSYS;
+#endif
+}   /* cut_perf_open_counters() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Checks once, before any test starts, whether the hardware event counters
+ * can be opened, and if not prints a note saying why to stderr. Doing it
+ * here keeps the note from landing in the middle of a test's result line.
+ */
+static void cut_perf_probe(void)
+{
+  int fd[CUT_PERF_COUNT];
+  int error = cut_perf_open_counters(fd);
+#if defined(__linux__)
+  int i = 0;
+
+  for (i = 0; i < CUT_PERF_COUNT; i++)
+  {
+    if (fd[i] >= 0)
+    {
+      close(fd[i]);
+    }
+  }
+#endif
+
+  if (0 == error)
+  {
+    return;
+  }
+
+#if defined(__linux__)
+  fprintf(stderr, "cut: hardware counters are not available (%s)%s\n", strerror(error),
+          ((EACCES == error) || (EPERM == error)) ? "; see /proc/sys/kernel/perf_event_paranoid" : "");
+#else
+  fprintf(stderr, "cut: hardware counters are only available on Linux\n");
+#endif
+}   /* cut_perf_probe() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Opens the hardware event counters of @a worker, for the calling thread,
+ * unless they are open or known to be unavailable. cut_perf_probe() has
+ * already told the user if none can be opened.
+ */
+static void cut_perf_open(cut_worker_t* worker)
+{
+  if (0 != worker->perf_state)
+  {
+    return;
+  }
+
+  worker->perf_state = (0 == cut_perf_open_counters(worker->perf_fd)) ? 1 : -1;
+}   /* cut_perf_open() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Closes the hardware event counters of @a worker, if open.
+ */
+static void cut_perf_close(cut_worker_t* worker)
+{
+#if defined(__linux__)
+  int i = 0;
+
+  for (i = 0; (worker->perf_state > 0) && (i < CUT_PERF_COUNT); i++)
+  {
+    if (worker->perf_fd[i] >= 0)
+    {
+      close(worker->perf_fd[i]);
+    }
+  }
+#endif
+
+  worker->perf_state = 0;
+}   /* cut_perf_close() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Reads the counts of @a worker's open counters into @a count, scaled up
+ * for any time that the kernel had to leave a counter off to share the
+ * hardware among more events than it has counters for.
+ */
+static void cut_perf_read(const cut_worker_t* worker, uint64_t count[CUT_PERF_COUNT])
+{
+  int i = 0;
+
+  for (i = 0; i < CUT_PERF_COUNT; i++)
+  {
+    uint64_t value[3] = { 0, 0, 0 };   /* Count, time enabled, time running. */
+
+    count[i] = 0;
+
+#if defined(__linux__)
+    if ((worker->perf_fd[i] >= 0) && (sizeof(value) == read(worker->perf_fd[i], value, sizeof(value))))
+    {
+      count[i] = ((value[2] > 0) && (value[2] < value[1])) ? (uint64_t) ((double) value[0] * value[1] / value[2]) : value[0];
+    }
+#else
+    (void) worker;
+    (void) value;
+#endif
+  }
+}   /* cut_perf_read() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Ends @a phase of the running test on @a worker, adding the events
+ * counted since the end of the last phase to it. With @a phase -1, only
+ * marks the start of a test.
+ */
+static void cut_perf_phase(cut_worker_t* worker, int phase)
+{
+  uint64_t count[CUT_PERF_COUNT];
+  int i = 0;
+
+  if (!cut_perf_counters || (worker->perf_state <= 0))
+  {
+    return;
+  }
+
+  cut_perf_read(worker, count);
+
+  for (i = 0; (phase >= 0) && (i < CUT_PERF_COUNT); i++)
+  {
+    worker->perf_test[phase][i] += count[i] - worker->perf_mark[i];
+  }
+
+  memcpy(worker->perf_mark, count, sizeof(count));
+}   /* cut_perf_phase() */
+
+#if CUT_ALLOC_HOOKS
+/*
+ * The C library's own allocator, which the hooks below pass each call on to.
+ */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* pointer, size_t size);
+extern void  __libc_free(void* pointer);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void* __libc_valloc(size_t size);
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the slot of @a stats' live block table where @a pointer is, or
+ * the empty slot where it would go.
+ */
+static size_t cut_alloc_slot(const cut_alloc_stats_t* stats, const void* pointer)
+{
+  size_t i = (size_t) ((((uintptr_t) pointer) >> 4) * 0x9E3779B1u) & (stats->live_size - 1);
+
+  while ((NULL != stats->live[i].pointer) && (pointer != stats->live[i].pointer))
+  {
+    i = (i + 1) & (stats->live_size - 1);
+  }
+
+  return i;
+}   /* cut_alloc_slot() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Counts the allocation of @a size bytes at @a pointer in @a stats. The
+ * table of live blocks is grown with the C library's allocator, so the
+ * hooks are not entered again. If it cannot be grown, the block is counted
+ * but never found to be freed.
+ */
+static void cut_alloc_note(cut_alloc_stats_t* stats, void* pointer, size_t size)
+{
+  size_t i = 0;
+
+  stats->count++;
+  stats->bytes += size;
+  stats->live_count++;
+  stats->live_bytes += size;
+
+  if (stats->live_bytes > stats->peak_bytes)
+  {
+    stats->peak_bytes = stats->live_bytes;
+  }
+
+  if (2 * stats->live_count > stats->live_size)
+  {
+    cut_alloc_stats_t grown = *stats;
+
+    grown.live_size = (stats->live_size > 0) ? 2 * stats->live_size : 0x100;
+    grown.live = (cut_alloc_block_t*) __libc_calloc(grown.live_size, sizeof(cut_alloc_block_t));
+
+    if (NULL == grown.live)
+    {
+      return;
+    }
+
+    for (i = 0; i < stats->live_size; i++)
+    {
+      if (NULL != stats->live[i].pointer)
+      {
+        grown.live[cut_alloc_slot(&grown, stats->live[i].pointer)] = stats->live[i];
+      }
+    }
+
+    __libc_free(stats->live);
+    stats->live = grown.live;
+    stats->live_size = grown.live_size;
+  }
+
+  i = cut_alloc_slot(stats, pointer);
+  stats->live[i].pointer = pointer;
+  stats->live[i].size = size;
+}   /* cut_alloc_note() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Counts the freeing of the block at @a pointer in @a stats, if the block
+ * is one that the running test allocated.
+ */
+static void cut_alloc_forget(cut_alloc_stats_t* stats, const void* pointer)
+{
+  size_t i = 0;
+  size_t j = 0;
+
+  if (0 == stats->live_size)
+  {
+    return;
+  }
+
+  i = cut_alloc_slot(stats, pointer);
+
+  if (NULL == stats->live[i].pointer)
+  {
+    return;
+  }
+
+  stats->live_count--;
+  stats->live_bytes -= stats->live[i].size;
+  stats->live[i].pointer = NULL;
+
+  /*
+   * Move back any later blocks of the probe sequence that would no longer
+   * be found past the hole.
+   */
+  for (j = (i + 1) & (stats->live_size - 1); NULL != stats->live[j].pointer; j = (j + 1) & (stats->live_size - 1))
+  {
+    size_t k = cut_alloc_slot(stats, stats->live[j].pointer);
+
+    if (k != j)
+    {
+      stats->live[k] = stats->live[j];
+      stats->live[j].pointer = NULL;
+    }
+  }
+}   /* cut_alloc_forget() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Counts the allocation of @a size bytes at @a pointer, called from
+ * @a caller, for the running test and in each open allocation budget.
+ */
+static void cut_alloc_hook(void* pointer, size_t size, void* caller)
+{
+  int i = 0;
+
+  if (NULL != g_cut_allocs)
+  {
+    cut_alloc_note(g_cut_allocs, pointer, size);
+  }
+
+  for (i = 0; i < g_cut_alloc_depth; i++)
+  {
+    cut_alloc_region_t* region = &g_cut_alloc_region[i];
+
+    region->count++;
+    region->bytes += size;
+
+    if ((NULL == region->first_over) && ((region->count > region->max_count) || (region->bytes > region->max_bytes)))
+    {
+      region->first_over = caller;
+      region->first_over_size = size;
+    }
+  }
+}   /* cut_alloc_hook() */
+
+/**
+ * @return non-zero if allocations on this thread are being counted.
+ */
+#define CUT_ALLOC_COUNTING()  ((NULL != g_cut_allocs) || (g_cut_alloc_depth > 0))
+
+/* ------------------------------------------------------------------------- */
+void* malloc(size_t size)
+{
+  void* pointer = __libc_malloc(size);
+
+  if ((NULL != pointer) && CUT_ALLOC_COUNTING())
+  {
+    cut_alloc_hook(pointer, size, __builtin_return_address(0));
+  }
+
+  return pointer;
+}   /* malloc() */
+
+/* ------------------------------------------------------------------------- */
+void* calloc(size_t count, size_t size)
+{
+  void* pointer = NULL;
+
+  if ((0 != size) && (count > SIZE_MAX / size))
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  pointer = __libc_calloc(count, size);
+
+  if ((NULL != pointer) && CUT_ALLOC_COUNTING())
+  {
+    cut_alloc_hook(pointer, count * size, __builtin_return_address(0));
+  }
+
+  return pointer;
+}   /* calloc() */
+
+/* ------------------------------------------------------------------------- */
+void* realloc(void* pointer, size_t size)
+{
+  void* moved = __libc_realloc(pointer, size);
+
+  if ((NULL != g_cut_allocs) && (NULL != pointer) && ((NULL != moved) || (0 == size)))
+  {
+    cut_alloc_forget(g_cut_allocs, pointer);
+  }
+
+  if ((NULL != moved) && CUT_ALLOC_COUNTING())
+  {
+    cut_alloc_hook(moved, size, __builtin_return_address(0));
+  }
+
+  return moved;
+}   /* realloc() */
+
+/* ------------------------------------------------------------------------- */
+void* memalign(size_t alignment, size_t size)
+{
+  void* pointer = __libc_memalign(alignment, size);
+
+  if ((NULL != pointer) && CUT_ALLOC_COUNTING())
+  {
+    cut_alloc_hook(pointer, size, __builtin_return_address(0));
+  }
+
+  return pointer;
+}   /* memalign() */
+
+/* ------------------------------------------------------------------------- */
+void* aligned_alloc(size_t alignment, size_t size)
+{
+  void* pointer = NULL;
+
+  if ((0 == alignment) || (0 != (alignment & (alignment - 1))))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  pointer = __libc_memalign(alignment, size);
+
+  if ((NULL != pointer) && CUT_ALLOC_COUNTING())
+  {
+    cut_alloc_hook(pointer, size, __builtin_return_address(0));
+  }
+
+  return pointer;
+}   /* aligned_alloc() */
+
+/* ------------------------------------------------------------------------- */
+int posix_memalign(void** result, size_t alignment, size_t size)
+{
+  void* pointer = NULL;
+
+  if ((alignment < sizeof(void*)) || (0 != (alignment & (alignment - 1))))
+  {
+    return EINVAL;
+  }
+
+  if (NULL == (pointer = __libc_memalign(alignment, size)))
+  {
+    return ENOMEM;
+  }
+
+  if (CUT_ALLOC_COUNTING())
+  {
+    cut_alloc_hook(pointer, size, __builtin_return_address(0));
+  }
+
+  *result = pointer;
+  return 0;
+}   /* posix_memalign() */
+
+/* ------------------------------------------------------------------------- */
+void* valloc(size_t size)
+{
+  void* pointer = __libc_valloc(size);
+
+  if ((NULL != pointer) && CUT_ALLOC_COUNTING())
+  {
+    cut_alloc_hook(pointer, size, __builtin_return_address(0));
+  }
+
+  return pointer;
+}   /* valloc() */
+
+/* ------------------------------------------------------------------------- */
+void free(void* pointer)
+{
+  if ((NULL != g_cut_allocs) && (NULL != pointer))
+  {
+    cut_alloc_forget(g_cut_allocs, pointer);
+  }
+
+  __libc_free(pointer);
+}   /* free() */
+#endif
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Starts counting the allocations of the calling thread in @a worker.
+ */
+static void cut_alloc_start(cut_worker_t* worker)
+{
+  cut_alloc_stats_t* stats = &worker->allocs;
+
+  if (stats->live_size > 0)
+  {
+    memset(stats->live, 0, stats->live_size * sizeof(stats->live[0]));
+  }
+
+  stats->count = 0;
+  stats->bytes = 0;
+  stats->live_count = 0;
+  stats->live_bytes = 0;
+  stats->peak_bytes = 0;
+  worker->allocs_tracked = CUT_ALLOC_HOOKS;
+  g_cut_allocs = CUT_ALLOC_HOOKS ? stats : NULL;
+}   /* cut_alloc_start() */
+
+/* ------------------------------------------------------------------------- */
+int cut_alloc_region_begin(unsigned long long max_count, unsigned long long max_bytes)
+{
+  cut_alloc_region_t* region = NULL;
+
+  if (g_cut_alloc_depth >= CUT_ALLOC_REGION_DEPTH)
+  {
+    return -1;
+  }
+
+  region = &g_cut_alloc_region[g_cut_alloc_depth];
+  memset(region, 0, sizeof(*region));
+  region->max_count = max_count;
+  region->max_bytes = max_bytes;
+  return g_cut_alloc_depth++;
+}   /* cut_alloc_region_begin() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Describes the code at @a address in @a text, as the name of its function
+ * and the offset into it where the symbol is known, or its offset in the
+ * program, which addr2line turns into a file and line.
+ */
+static void cut_describe_address(void* address, char* text, size_t size)
+{
+  snprintf(text, size, "%p", address);
+
+#if CUT_ALLOC_HOOKS
+  {
+    cut_alloc_stats_t* allocs = g_cut_allocs;
+    int alloc_depth = g_cut_alloc_depth;
+    char** symbols = NULL;
+
+    /*
+     * backtrace_symbols() allocates; that is cut's, not the test's, nor
+     * that of any budget still open around this one.
+     */
+    g_cut_allocs = NULL;
+    g_cut_alloc_depth = 0;
+    symbols = backtrace_symbols(&address, 1);
+
+    if (NULL != symbols)
+    {
+      snprintf(text, size, "%s", symbols[0]);
+      free(symbols);
+    }
+
+    g_cut_allocs = allocs;
+    g_cut_alloc_depth = alloc_depth;
+  }
+#endif
+}   /* cut_describe_address() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_alloc_region(const char* file, int line, int region_index, const char* code)
+{
+  cut_alloc_region_t region;
+  char limit[0x40] = "";
+  char where[0x100] = "";
+
+  if ((region_index < 0) || (region_index >= g_cut_alloc_depth))
+  {
+    return cut_assertf(file, line, 0, "allocation budgets nested more than %d deep: %s", CUT_ALLOC_REGION_DEPTH, code);
+  }
+
+  /*
+   * Close this budget, and any left open within it.
+   */
+  region = g_cut_alloc_region[region_index];
+  g_cut_alloc_depth = region_index;
+
+  if (!CUT_ALLOC_HOOKS)
+  {
+    cut_assertion_result(file, line, CUT_RESULT_SKIP, "allocations are not counted in this build (see CUT_ALLOC_HOOKS)");
+    return CUT_RESULT_PASS;
+  }
+
+  if ((CUT_ALLOC_UNLIMITED == region.max_count) || (CUT_ALLOC_UNLIMITED == region.max_bytes))
+  {
+    snprintf(limit, sizeof(limit), (CUT_ALLOC_UNLIMITED == region.max_count) ? "%llu bytes" : "%llu",
+             (CUT_ALLOC_UNLIMITED == region.max_count) ? region.max_bytes : region.max_count);
+  }
+  else
+  {
+    snprintf(limit, sizeof(limit), "%llu and %llu bytes", region.max_count, region.max_bytes);
+  }
+
+  if (NULL == region.first_over)
+  {
+    return cut_assertf(file, line, 1, "%llu allocations (%llu bytes), at most %s: %s",
+                       region.count, region.bytes, limit, code);
+  }
+
+  cut_describe_address(region.first_over, where, sizeof(where));
+  return cut_assertf(file, line, 0, "%llu allocations (%llu bytes), at most %s; first past it: %llu bytes from %s: %s",
+                     region.count, region.bytes, limit, (unsigned long long) region.first_over_size, where, code);
+}   /* cut_assert_alloc_region() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_mutex_init(cut_mutex_t* mutex)
+{
+#if defined(_WIN32)
+  InitializeCriticalSection(mutex);
+#else
+  pthread_mutex_init(mutex, NULL);
+#endif
+}   /* cut_mutex_init() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_mutex_destroy(cut_mutex_t* mutex)
+{
+#if defined(_WIN32)
+  DeleteCriticalSection(mutex);
+#else
+  pthread_mutex_destroy(mutex);
+#endif
+}   /* cut_mutex_destroy() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_mutex_lock(cut_mutex_t* mutex)
+{
+#if defined(_WIN32)
+  EnterCriticalSection(mutex);
+#else
+  pthread_mutex_lock(mutex);
+#endif
+}   /* cut_mutex_lock() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_mutex_unlock(cut_mutex_t* mutex)
+{
+#if defined(_WIN32)
+  LeaveCriticalSection(mutex);
+#else
+  pthread_mutex_unlock(mutex);
+#endif
+}   /* cut_mutex_unlock() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_cond_init(cut_cond_t* cond)
+{
+#if defined(_WIN32)
+  InitializeConditionVariable(cond);
+#else
+  pthread_cond_init(cond, NULL);
+#endif
+}   /* cut_cond_init() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_cond_destroy(cut_cond_t* cond)
+{
+#if defined(_WIN32)
+  (void) cond;
+#else
+  pthread_cond_destroy(cond);
+#endif
+}   /* cut_cond_destroy() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases @a mutex, which the caller holds, until @a cond is signalled.
+ */
+static void cut_cond_wait(cut_cond_t* cond, cut_mutex_t* mutex)
+{
+#if defined(_WIN32)
+  SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+  pthread_cond_wait(cond, mutex);
+#endif
+}   /* cut_cond_wait() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_cond_broadcast(cut_cond_t* cond)
+{
+#if defined(_WIN32)
+  WakeAllConditionVariable(cond);
+#else
+  pthread_cond_broadcast(cond);
+#endif
+}   /* cut_cond_broadcast() */
+
+/* ------------------------------------------------------------------------- */
+#if defined(_WIN32)
+static DWORD WINAPI cut_thread_entry(LPVOID arg)
+{
+  cut_thread_t* thread = (cut_thread_t*) arg;
+  thread->func(thread->arg);
+  return 0;
+}   /* cut_thread_entry() */
+#else
+static void* cut_thread_entry(void* arg)
+{
+  cut_thread_t* thread = (cut_thread_t*) arg;
+  thread->func(thread->arg);
+  return NULL;
+}   /* cut_thread_entry() */
+#endif
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Starts @a thread running @a func(@a arg).
+ *
+ * @return CUT_RESULT_PASS on success, CUT_RESULT_ERROR if the thread could
+ * not be created.
+ */
+static cut_result_t cut_thread_start(cut_thread_t* thread, cut_thread_func_t func, void* arg)
+{
+  assert(NULL != thread);
+  assert(NULL != func);
+
+  thread->func = func;
+  thread->arg = arg;
+#if defined(_WIN32)
+  thread->handle = CreateThread(NULL, 0, cut_thread_entry, thread, 0, NULL);
+  return (NULL == thread->handle) ? CUT_RESULT_ERROR : CUT_RESULT_PASS;
+#else
+  return (0 != pthread_create(&thread->handle, NULL, cut_thread_entry, thread)) ? CUT_RESULT_ERROR : CUT_RESULT_PASS;
+#endif
+}   /* cut_thread_start() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_thread_join(cut_thread_t* thread)
+{
+#if defined(_WIN32)
+  WaitForSingleObject(thread->handle, INFINITE);
+  CloseHandle(thread->handle);
+#else
+  pthread_join(thread->handle, NULL);
+#endif
+}   /* cut_thread_join() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_barrier_init(cut_barrier_t* barrier, int count)
+{
+  assert(NULL != barrier);
+  assert(count > 0);
+
+  cut_mutex_init(&barrier->lock);
+  cut_cond_init(&barrier->cond);
+  barrier->count = count;
+  barrier->waiting = 0;
+  barrier->generation = 0;
+}   /* cut_barrier_init() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_barrier_destroy(cut_barrier_t* barrier)
+{
+  assert(NULL != barrier);
+
+  cut_cond_destroy(&barrier->cond);
+  cut_mutex_destroy(&barrier->lock);
+}   /* cut_barrier_destroy() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Waits until all of @a barrier's threads have reached it.
+ */
+static void cut_barrier_wait(cut_barrier_t* barrier)
+{
+  unsigned generation = 0;
+
+  assert(NULL != barrier);
+
+  cut_mutex_lock(&barrier->lock);
+  generation = barrier->generation;
+
+  if (++barrier->waiting == barrier->count)
+  {
+    barrier->waiting = 0;
+    barrier->generation++;
+    cut_cond_broadcast(&barrier->cond);
+  }
+
+  while (generation == barrier->generation)
+  {
+    cut_cond_wait(&barrier->cond, &barrier->lock);
+  }
+
+  cut_mutex_unlock(&barrier->lock);
+}   /* cut_barrier_wait() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the number of online processors, at least 1.
+ */
+static int cut_cpu_count(void)
+{
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (info.dwNumberOfProcessors > 0) ? (int) info.dwNumberOfProcessors : 1;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return (count > 0) ? (int) count : 1;
+#endif
+}   /* cut_cpu_count() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Suspends the calling thread for about @a usec microseconds.
+ */
+static void cut_sleep_usec(usec_t usec)
+{
+#if defined(_WIN32)
+  Sleep((DWORD) ((usec + 999) / 1000));
+#else
+  struct timespec delay;
+
+  delay.tv_sec = (time_t) (usec / 1000000);
+  delay.tv_nsec = (long) (usec % 1000000) * 1000;
+
+  while ((nanosleep(&delay, &delay) < 0) && (EINTR == errno))
+  {
+  }
+#endif
+}   /* cut_sleep_usec() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param c - the character whose image is sought.
+ *
+ * @param image - buffer to hold the image, or NULL for a shared buffer. This
+ * must point to a buffer of at least CHAR_IMAGE_MAX_LEN characters.
+ *
  * @return a printable image of character @a c.
  */
-static const char* char_image(char c, char* image)
+static const char* char_image(char c, char* image)
+{
+  static char shared_image[CHAR_IMAGE_MAX_LEN] = "";
+
+  image = (NULL == image) ? shared_image : image;
+
+  switch (c)
+  {
+  case '\'': strncpy(image, "'\\''", CHAR_IMAGE_MAX_LEN); break;
+  case '\t': strncpy(image, "'\\t'", CHAR_IMAGE_MAX_LEN); break;
+  case '\r': strncpy(image, "'\\r'", CHAR_IMAGE_MAX_LEN); break;
+  case '\n': strncpy(image, "'\\n'", CHAR_IMAGE_MAX_LEN); break;
+
+  default:
+    if (isprint(c))
+    {
+      image[0] = '\'';
+      image[1] = c;
+      image[2] = '\'';
+      image[3] = 0;
+      return image;
+    }
+    if (c < 10) snprintf(image, CHAR_IMAGE_MAX_LEN - 1, "'\\%u'", (unsigned) (unsigned char) c);
+    else        snprintf(image, CHAR_IMAGE_MAX_LEN - 1, "'\\x%02X'", (unsigned) (unsigned char) c);
+  }
+
+  image[CHAR_IMAGE_MAX_LEN-1] = 0;
+  return image;
+}   /* char_image() */
+
+/* ------------------------------------------------------------------------- */
+static char* printable_diff_string(char* printable, const char* src, size_t len, size_t diff_index)
+{
+  const size_t half_len = (PRINTABLE_DIFF_STRING_MAX_LEN / 2) - 2;   /* Allow for two dots on either side. */
+
+  assert(src && printable);
+
+  if (len < PRINTABLE_DIFF_STRING_MAX_LEN)
+  {
+    /*
+     * If there's no need to truncate.
+     */
+    strncpy(printable, src, PRINTABLE_DIFF_STRING_MAX_LEN-1);
+  }
+  else if (diff_index > half_len)
+  {
+    /*
+     * If the difference appears more than halfway through the buffer, use a
+     * leading ellipsis.
+     */
+    printable[0] = '.';
+    printable[2] = '.';
+    strncpy(&printable[2], &src[diff_index - half_len], PRINTABLE_DIFF_STRING_MAX_LEN-1-2);
+
+    if (len > (diff_index + half_len))
+    {
+      /*
+       * If a trailing ellipsis is needed, too.
+       */
+      printable[PRINTABLE_DIFF_STRING_MAX_LEN-1-2] = '.';
+      printable[PRINTABLE_DIFF_STRING_MAX_LEN-1-1] = '.';
+    }
+  }
+  else   /* else the difference occurs early in a long string... */
+  {
+    strncpy(printable, src, PRINTABLE_DIFF_STRING_MAX_LEN-1);
+    printable[PRINTABLE_DIFF_STRING_MAX_LEN-1-2] = '.';
+    printable[PRINTABLE_DIFF_STRING_MAX_LEN-1-1] = '.';
+  }
+
+  printable[PRINTABLE_DIFF_STRING_MAX_LEN-1] = 0;
+  return printable;
+}   /* printable_diff_string() */
+
+/* ------------------------------------------------------------------------- */
+static int remove_tail(const char* name, size_t* length, size_t before, const char* tail)
+{
+  const size_t tail_length = strlen(tail);
+
+  if ((before + *length > tail_length) && (*length >= tail_length) &&
+      (0 == strncasecmp(&name[*length - tail_length], tail, tail_length)))
+  {
+    *length -= tail_length;
+    return 1;
+  }
+
+  return 0;
+}   /* remove_tail() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the length of @a name once shortened. @a before is the length of
+ * what comes before @a name in the full name, if anything.
+ */
+static size_t shorten_name(const char* name, size_t before)
+{
+  size_t length = strlen(name);
+
+  if (cut_shorten_names)
+  {
+    if (!remove_tail(name, &length, before, "_test")) remove_tail(name, &length, before, "test");
+  }
+
+  return length;
+}   /* shorten_name() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Adds the @a length bytes at @a text to the 32-bit FNV-1a @a hash.
+ */
+static uint32_t cut_hash_update(uint32_t hash, const char* text, size_t length)
+{
+  while (length-- > 0)
+  {
+    hash ^= (unsigned char) *text++;
+    hash *= 0x01000193;
+  }
+
+  return hash;
+}   /* cut_hash_update() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the 32-bit FNV-1a hash of @a text. This is stable from one run
+ * (and one machine) to the next.
+ */
+static uint32_t cut_hash_string(const char* text)
+{
+  return cut_hash_update(0x811C9DC5, text, strlen(text));
+}   /* cut_hash_string() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the copy in the name pool of the @a length bytes at @a text,
+ * stored with a terminating NUL the first time that it is seen, or NULL if
+ * out of memory.
+ */
+static const char* cut_intern(const char* text, size_t length)
+{
+  cut_chunk_t* chunk = g_cut->names;
+  uint32_t hash = cut_hash_update(0x811C9DC5, text, length);
+  size_t i = 0;
+  char* copy = NULL;
+
+  if (2 * (g_cut->name_count + 1) > g_cut->name_table_size)
+  {
+    size_t size = (g_cut->name_table_size > 0) ? (2 * g_cut->name_table_size) : 0x400;
+    const char** table = (const char**) calloc(size, sizeof(table[0]));
+
+    if (NULL == table)
+    {
+      return NULL;
+    }
+
+    for (i = 0; i < g_cut->name_table_size; i++)
+    {
+      const char* name = g_cut->name_table[i];
+
+      if (NULL != name)
+      {
+        size_t j = cut_hash_string(name) & (size - 1);
+
+        while (NULL != table[j])
+        {
+          j = (j + 1) & (size - 1);
+        }
+
+        table[j] = name;
+      }
+    }
+
+    free(g_cut->name_table);
+    g_cut->name_table = table;
+    g_cut->name_table_size = size;
+  }
+
+  for (i = hash & (g_cut->name_table_size - 1);
+       NULL != g_cut->name_table[i];
+       i = (i + 1) & (g_cut->name_table_size - 1))
+  {
+    const char* name = g_cut->name_table[i];
+
+    if ((0 == strncmp(name, text, length)) && (0 == name[length]))
+    {
+      return name;
+    }
+  }
+
+  if ((NULL == chunk) || (chunk->size - chunk->used < length + 1))
+  {
+    size_t size = (length + 1 > CUT_NAME_CHUNK_SIZE) ? (length + 1) : CUT_NAME_CHUNK_SIZE;
+
+    chunk = (cut_chunk_t*) malloc(sizeof(*chunk) + size);
+
+    if (NULL == chunk)
+    {
+      return NULL;
+    }
+
+    chunk->next = g_cut->names;
+    chunk->used = 0;
+    chunk->size = size;
+    g_cut->names = chunk;
+  }
+
+  copy = &chunk->text[chunk->used];
+  chunk->used += length + 1;
+  memcpy(copy, text, length);
+  copy[length] = 0;
+  g_cut->name_table[i] = copy;
+  g_cut->name_count++;
+  return copy;
+}   /* cut_intern() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Makes room in @a array, which has room for @a *size items of @a item
+ * bytes, for at least @a count items. The array is doubled in size as
+ * needed, so that appending one item at a time takes amortized constant
+ * time.
+ *
+ * @return the (possibly moved) array, with *size updated, or NULL if out of
+ * memory, in which case @a array is unchanged.
+ */
+static void* cut_reserve(void* array, size_t* size, size_t count, size_t item)
+{
+  size_t new_size = (*size > 0) ? *size : 16;
+
+  if (count <= *size)
+  {
+    return array;
+  }
+
+  while (new_size < count)
+  {
+    new_size *= 2;
+  }
+
+  array = realloc(array, new_size * item);
+
+  if (NULL != array)
+  {
+    *size = new_size;
+  }
+
+  return array;
+}   /* cut_reserve() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the suite that @a test belongs to.
+ */
+static cut_suite_t* cut_test_suite(const cut_test_t* test)
+{
+  return &g_cut->suite[test->suite];
+}   /* cut_test_suite() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The full name of test @a _t ("suite.test") as the two arguments for a
+ * "%s%s" format: the suite's prefix and the test's own name.
+ */
+#define CUT_TEST_NAME(_t)  cut_test_suite(_t)->prefix, g_cut->test_name[(_t) - g_cut->test]
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the hash of the full name of @a test, the same as
+ * cut_hash_string() of the whole name.
+ */
+static uint32_t cut_hash_test_name(const cut_test_t* test)
+{
+  const char* name = g_cut->test_name[test - g_cut->test];
+  const cut_suite_t* suite = &g_cut->suite[test->suite];
+
+  return cut_hash_update(cut_hash_update(0x811C9DC5, suite->prefix, suite->prefix_length), name, strlen(name));
+}   /* cut_hash_test_name() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return non-zero if the full name of @a test is @a name.
+ */
+static int cut_test_name_is(const cut_test_t* test, const char* name)
+{
+  const cut_suite_t* suite = &g_cut->suite[test->suite];
+
+  return (0 == strncmp(name, suite->prefix, suite->prefix_length)) &&
+         (0 == strcmp(&name[suite->prefix_length], g_cut->test_name[test - g_cut->test]));
+}   /* cut_test_name_is() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Writes the full name of @a test into @a *buffer, which has room for
+ * @a *size bytes and is enlarged as needed.
+ *
+ * @return *buffer, or NULL if out of memory.
+ */
+static char* cut_format_test_name(const cut_test_t* test, char** buffer, size_t* size)
+{
+  const char* name = g_cut->test_name[test - g_cut->test];
+  const cut_suite_t* suite = &g_cut->suite[test->suite];
+  size_t length = strlen(name);
+  char* text = (char*) cut_reserve(*buffer, size, suite->prefix_length + length + 1, 1);
+
+  if (NULL == text)
+  {
+    return NULL;
+  }
+
+  memcpy(text, suite->prefix, suite->prefix_length);
+  memcpy(&text[suite->prefix_length], name, length + 1);
+  *buffer = text;
+  return text;
+}   /* cut_format_test_name() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Appends a new suite named @a name.
+ *
+ * @return the suite, or NULL if out of memory.
+ */
+static cut_suite_t* cut_new_suite(const char* name)
+{
+  cut_suite_t* suite = NULL;
+  char* prefix = NULL;
+  size_t length = 0;
+  size_t active = (NULL != g_cut->active_suite) ? (size_t) (g_cut->active_suite - g_cut->suite) : 0;
+
+  suite = (cut_suite_t*) cut_reserve(g_cut->suite, &g_cut->suite_size, g_cut->suite_count + 1, sizeof(*suite));
+
+  if (NULL == suite)
+  {
+    return NULL;
+  }
+
+  /*
+   * A suite may be installed from another suite's installer, which is still
+   * adding tests to the active suite after the array moves.
+   */
+  if (NULL != g_cut->active_suite)
+  {
+    g_cut->active_suite = &suite[active];
+  }
+
+  /*
+   * The tests of a suite are added right after it is installed, so they
+   * follow those of the suites before it.
+   */
+  g_cut->suite = suite;
+  suite = &g_cut->suite[g_cut->suite_count];
+  memset(suite, 0, sizeof(*suite));
+  length = shorten_name(name, 0);
+  prefix = (char*) malloc(length + strlen(cut_name_delimiter) + 1);
+
+  if (NULL != prefix)
+  {
+    memcpy(prefix, name, length);
+    strcpy(&prefix[length], cut_name_delimiter);
+    suite->name = cut_intern(prefix, length);
+    suite->prefix_length = strlen(prefix);
+    suite->prefix = cut_intern(prefix, suite->prefix_length);
+    free(prefix);
+  }
+
+  if ((NULL == suite->name) || (NULL == suite->prefix))
+  {
+    return NULL;
+  }
+
+  g_cut->suite_count++;
+  suite->first = g_cut->test_count;
+  return suite;
+}   /* cut_new_suite() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_install_suite(const char* name, cut_install_func_t suite_install)
+{
+  cut_suite_t* suite = NULL;
+
+  assert(NULL != name);
+  assert(NULL != suite_install);
+
+  suite = cut_new_suite(name);
+
+  if (NULL == suite)
+  {
+    return CUT_RESULT_FAIL;
+  }
+
+  /*
+   * The installer is called later, and only if the suite may hold a test
+   * that is selected.
+   */
+  suite->install = suite_install;
+  return CUT_RESULT_PASS;
+}   /* cut_install_suite() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_config_suite(size_t size, cut_init_func_t test_init, cut_exit_func_t test_exit)
+{
+  cut_result_t result = CUT_RESULT_PASS;
+  cut_suite_t* suite = NULL;
+  assert(NULL != g_cut);
+  assert(NULL != g_cut->active_suite);
+
+  suite = g_cut->active_suite;
+
+  if (NULL != suite->data)
+  {
+    free(suite->data);
+    suite->data = NULL;
+    suite->size = 0;
+  }
+
+  free(suite->snapshot);
+  suite->snapshot = NULL;
+  suite->init = NULL;
+  suite->exit = NULL;
+
+  if (size > 0)
+  {
+    suite->data = malloc(size);
+
+    if (NULL == suite->data)
+    {
+      result = CUT_RESULT_FAIL;
+    }
+    else
+    {
+      suite->size = size;
+      suite->init = test_init;
+      suite->exit = test_exit;
+    }
+  }
+
+  return result;
+}   /* cut_config_suite() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_config_suite_snapshot(size_t size, cut_init_func_t test_init, cut_exit_func_t test_exit)
+{
+  cut_suite_t* suite = NULL;
+  assert(NULL != g_cut);
+  assert(NULL != g_cut->active_suite);
+
+  suite = g_cut->active_suite;
+
+  if (CUT_RESULT_PASS != cut_config_suite(size, test_init, test_exit))
+  {
+    return CUT_RESULT_FAIL;
+  }
+
+  if (size > 0)
+  {
+    suite->snapshot = malloc(size);
+
+    if (NULL == suite->snapshot)
+    {
+      return CUT_RESULT_FAIL;
+    }
+  }
+
+  return CUT_RESULT_PASS;
+}   /* cut_config_suite_snapshot() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_config_suite_once(size_t size, cut_init_func_t suite_setup, cut_exit_func_t suite_teardown)
+{
+  cut_suite_t* suite = NULL;
+  assert(NULL != g_cut);
+  assert(NULL != g_cut->active_suite);
+
+  suite = g_cut->active_suite;
+
+  free(suite->shared);
+  suite->shared = NULL;
+  suite->shared_size = 0;
+  suite->setup = NULL;
+  suite->teardown = NULL;
+
+  if (size > 0)
+  {
+    suite->shared = malloc(size);
+
+    if (NULL == suite->shared)
+    {
+      return CUT_RESULT_FAIL;
+    }
+
+    suite->shared_size = size;
+  }
+
+  suite->setup = suite_setup;
+  suite->teardown = suite_teardown;
+  return CUT_RESULT_PASS;
+}   /* cut_config_suite_once() */
+
+/* ------------------------------------------------------------------------- */
+void* cut_suite_data(void)
+{
+  cut_suite_t* suite = g_cut_worker->active_suite;
+
+  return (NULL != suite) ? suite->shared : NULL;
+}   /* cut_suite_data() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_config_timeout(unsigned timeout_msec)
+{
+  assert(NULL != g_cut);
+  assert(NULL != g_cut->active_suite);
+
+  g_cut->active_suite->timeout_msec = timeout_msec;
+  return CUT_RESULT_PASS;
+}   /* cut_config_timeout() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Makes room for @a count tests in all, in both the test array and the
+ * parallel array of names.
+ */
+static cut_result_t cut_reserve_tests(size_t count)
+{
+  cut_test_t* test = NULL;
+  const char** names = NULL;
+
+  test = (cut_test_t*) cut_reserve(g_cut->test, &g_cut->test_size, count, sizeof(*test));
+
+  if (NULL == test)
+  {
+    return CUT_RESULT_FAIL;
+  }
+
+  g_cut->test = test;
+  names = (const char**) cut_reserve(g_cut->test_name, &g_cut->test_name_size, count, sizeof(*names));
+
+  if (NULL == names)
+  {
+    return CUT_RESULT_FAIL;
+  }
+
+  g_cut->test_name = names;
+  return CUT_RESULT_PASS;
+}   /* cut_reserve_tests() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_add_test_timeout(const char* test_name, cut_test_func_t test_func, unsigned timeout_msec)
+{
+  cut_test_t* test = NULL;
+  const char* name = NULL;
+  cut_suite_t* suite = NULL;
+
+  assert(NULL != test_name);
+  assert(NULL != test_func);
+  assert(NULL != g_cut);
+  assert(NULL != g_cut->active_suite);
+
+  suite = g_cut->active_suite;
+  assert(suite->first + suite->count == g_cut->test_count);
+
+  if (CUT_RESULT_PASS != cut_reserve_tests(g_cut->test_count + 1))
+  {
+    return CUT_RESULT_FAIL;
+  }
+
+  /*
+   * Tests in different suites often share a name; it is stored only once.
+   */
+  name = cut_intern(test_name, shorten_name(test_name, suite->prefix_length));
+
+  if (NULL == name)
+  {
+    return CUT_RESULT_FAIL;
+  }
+
+  test = &g_cut->test[g_cut->test_count];
+  g_cut->test_name[g_cut->test_count] = name;
+  g_cut->test_count++;
+  suite->count++;
+
+  memset(test, 0, sizeof(*test));
+  test->flags = g_cut->include_test_called ? CUT_TEST_FLAG_EXCLUDE : 0;
+  test->func = test_func;
+  test->suite = (uint32_t) (suite - g_cut->suite);
+  test->timeout_msec = timeout_msec;
+  return CUT_RESULT_PASS;
+}   /* cut_add_test_timeout() */
+
+#if CUT_STATIC_SECTION
+/*
+ * Bounds of the "cut_tests" section, provided by the linker. They are weak
+ * so that a program without any CUT_TEST() still links.
+ */
+extern const cut_static_test_t* const __start_cut_tests[] __attribute__((weak));
+extern const cut_static_test_t* const __stop_cut_tests[] __attribute__((weak));
+#endif
+
+/* ------------------------------------------------------------------------- */
+void cut_register_static_test(cut_static_link_t* link)
+{
+  assert(NULL != link);
+
+  link->next = g_cut->static_tests;
+  g_cut->static_tests = link;
+}   /* cut_register_static_test() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Orders static tests by suite, then by where they are defined, so that the
+ * tests of a suite are installed together and in source order whatever
+ * order the linker or the constructors left them in.
+ */
+static int cut_compare_static(const void* a, const void* b)
+{
+  const cut_static_test_t* ta = *(const cut_static_test_t* const*) a;
+  const cut_static_test_t* tb = *(const cut_static_test_t* const*) b;
+  int rval = strcmp(ta->suite, tb->suite);
+
+  if (0 == rval)
+  {
+    rval = strcmp(ta->file, tb->file);
+  }
+
+  if (0 == rval)
+  {
+    rval = (ta->line > tb->line) - (ta->line < tb->line);
+  }
+
+  return rval;
+}   /* cut_compare_static() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Installer of a suite of CUT_TEST()s, which adds its tests from the
+ * static_list.
+ */
+static void cut_install_static_suite(void)
+{
+  cut_suite_t* suite = g_cut->active_suite;
+  size_t i = 0;
+
+  assert(NULL != suite);
+
+  if (CUT_RESULT_PASS != cut_reserve_tests(g_cut->test_count + suite->static_count))
+  {
+    return;
+  }
+
+  for (i = suite->static_first; i < suite->static_first + suite->static_count; i++)
+  {
+    const cut_static_test_t* test = g_cut->static_list[i];
+
+    if (CUT_RESULT_PASS != cut_add_test_timeout(test->name, test->func, test->timeout_msec))
+    {
+      break;
+    }
+  }
+}   /* cut_install_static_suite() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Adds a suite for each suite name used by CUT_TEST(), once, after those
+ * installed by cut_install_suite(). Like those, its tests are only added
+ * when cut_install_pending() finds that it may hold a selected test.
+ */
+static cut_result_t cut_install_static_tests(void)
+{
+  const cut_static_test_t** list = NULL;
+  const cut_static_link_t* link = NULL;
+  cut_suite_t* suite = NULL;
+  size_t count = 0;
+  size_t i = 0;
+  cut_result_t result = CUT_RESULT_PASS;
+
+  if (g_cut->static_installed)
+  {
+    return CUT_RESULT_PASS;
+  }
+
+  g_cut->static_installed = 1;
+
+#if CUT_STATIC_SECTION
+  if (NULL != __start_cut_tests)
+  {
+    count = (size_t) (__stop_cut_tests - __start_cut_tests);
+  }
+#endif
+
+  for (link = g_cut->static_tests; NULL != link; link = link->next)
+  {
+    count++;
+  }
+
+  if (0 == count)
+  {
+    return CUT_RESULT_PASS;
+  }
+
+  if (NULL == (list = (const cut_static_test_t**) malloc(count * sizeof(*list))))
+  {
+    return CUT_RESULT_FAIL;
+  }
+
+  count = 0;
+
+#if CUT_STATIC_SECTION
+  if (NULL != __start_cut_tests)
+  {
+    const cut_static_test_t* const* entry = NULL;
+
+    for (entry = __start_cut_tests; entry < __stop_cut_tests; entry++)
+    {
+      if (NULL != *entry)
+      {
+        list[count++] = *entry;
+      }
+    }
+  }
+#endif
+
+  for (link = g_cut->static_tests; NULL != link; link = link->next)
+  {
+    list[count++] = link->test;
+  }
+
+  qsort(list, count, sizeof(*list), cut_compare_static);
+  g_cut->static_list = list;
+  g_cut->static_count = count;
+
+  for (i = 0; i < count; i++)
+  {
+    if ((NULL == suite) || (0 != strcmp(list[i]->suite, list[i - 1]->suite)))
+    {
+      if (NULL == (suite = cut_new_suite(list[i]->suite)))
+      {
+        result = CUT_RESULT_FAIL;
+        break;
+      }
+
+      suite->install = cut_install_static_suite;
+      suite->static_first = i;
+    }
+
+    suite->static_count++;
+  }
+
+  return result;
+}   /* cut_install_static_tests() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_add_test(const char* test_name, cut_test_func_t test_func)
+{
+  return cut_add_test_timeout(test_name, test_func, 0);
+}   /* cut_add_test() */
+
+/* ------------------------------------------------------------------------- */
+static cut_result_t cut_run_benchmark(void* data);
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_add_benchmark(const char* benchmark_name, cut_benchmark_func_t benchmark_func)
+{
+  cut_result_t result = cut_add_test_timeout(benchmark_name, (NULL != benchmark_func) ? cut_run_benchmark : NULL, 0);
+
+  if (CUT_RESULT_PASS == result)
+  {
+    g_cut->test[g_cut->test_count - 1].flags |= CUT_TEST_FLAG_BENCHMARK;
+    g_cut->test[g_cut->test_count - 1].benchmark_func = benchmark_func;
+  }
+
+  return result;
+}   /* cut_add_benchmark() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_add_scaling_benchmark(const char* benchmark_name, cut_benchmark_func_t benchmark_func)
+{
+  cut_result_t result = cut_add_benchmark(benchmark_name, benchmark_func);
+
+  if (CUT_RESULT_PASS == result)
+  {
+    g_cut->test[g_cut->test_count - 1].flags |= CUT_TEST_FLAG_SCALING;
+  }
+
+  return result;
+}   /* cut_add_scaling_benchmark() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Parses @a value, the argument given to option @a name, as a non-negative
+ * integer. Prints a message to stderr on error.
+ *
+ * @return CUT_RESULT_PASS on success, CUT_RESULT_FAIL on error.
+ */
+static cut_result_t parse_int_option(const char* name, const char* value, int* number)
+{
+  char* end = NULL;
+  long n = 0;
+
+  assert(NULL != name);
+  assert(NULL != number);
+
+  if (NULL == value)
+  {
+    fprintf(stderr, "cut: option -%s requires a value\n", name);
+    return CUT_RESULT_FAIL;
+  }
+
+  n = strtol(value, &end, 0);
+
+  if ((end == value) || (*end != 0) || (n < 0) || (n > 0x7FFFFFFF))
+  {
+    fprintf(stderr, "cut: invalid value '%s' for option -%s\n", value, name);
+    return CUT_RESULT_FAIL;
+  }
+
+  *number = (int) n;
+  return CUT_RESULT_PASS;
+}   /* parse_int_option() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Reads the thread counts of scaling benchmarks from @a text, a
+ * comma-separated list, into @a counts, which holds
+ * CUT_BENCHMARK_MAX_COUNTS. If @a text is NULL the counts are the powers of
+ * two below the number of CPUs, then that number.
+ *
+ * @return the number of counts, or 0 if @a text is not a valid list.
+ */
+static int cut_parse_thread_counts(const char* text, int* counts)
+{
+  int count = 0;
+  int cpus = 0;
+  int n = 0;
+
+  if (NULL == text)
+  {
+    cpus = cut_cpu_count();
+
+    for (n = 1; (n < cpus) && (count < CUT_BENCHMARK_MAX_COUNTS - 1); n *= 2)
+    {
+      counts[count++] = n;
+    }
+
+    counts[count++] = (cpus < CUT_BENCHMARK_MAX_THREADS) ? cpus : CUT_BENCHMARK_MAX_THREADS;
+    return count;
+  }
+
+  for (;;)
+  {
+    char* end = NULL;
+    long value = strtol(text, &end, 10);
+
+    if ((end == text) || (value < 1) || (value > CUT_BENCHMARK_MAX_THREADS) || (count >= CUT_BENCHMARK_MAX_COUNTS))
+    {
+      return 0;
+    }
+
+    counts[count++] = (int) value;
+
+    if (0 == *end)
+    {
+      return count;
+    }
+
+    if (',' != *end)
+    {
+      return 0;
+    }
+
+    text = end + 1;
+  }
+}   /* cut_parse_thread_counts() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the name of the history file for this program, which is the
+ * program name with CUT_HISTORY_SUFFIX appended.
+ */
+static const char* cut_default_history_file(void)
+{
+  static char* name = NULL;
+  const char* program = (NULL != g_cut->program) ? g_cut->program : "cut";
+
+  if (NULL == name)
+  {
+    name = (char*) malloc(strlen(program) + strlen(CUT_HISTORY_SUFFIX) + 1);
+
+    if (NULL != name)
+    {
+      sprintf(name, "%s%s", program, CUT_HISTORY_SUFFIX);
+    }
+  }
+
+  return name;
+}   /* cut_default_history_file() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Processes command line arguments for cut-specific settings. If an error is
+ * found in a cut-specific setting then a message is printed to stderr and
+ * CUT_RESULT_FAIL is returned.
+ *
+ * See cut_usage() in cut.c for the available options.
+ */
+cut_result_t cut_parse_command_line(int* argc, char* argv[])
+{
+  cut_result_t result = CUT_RESULT_PASS;
+  int i = 0;
+
+  assert(NULL != argc);
+  assert(NULL != argv);
+
+  if (*argc > 0)
+  {
+    g_cut->program = argv[0];
+  }
+
+  for (i = 1; i < *argc; i++)
+  {
+    char* arg = argv[i];
+    char* value = (i + 1 < *argc) ? argv[i + 1] : NULL;
+    int arg_used = 1;
+
+    assert(NULL != arg);
+
+    if (*arg != '-')
+    {
+      continue;
+    }
+
+    if (*arg == '-') arg++;
+    if (*arg == '-') arg++;
+    if      (strcmp(arg, "show-cases"         ) == 0) cut_print_case_flags  = CUT_FLAG_ALL;
+    else if (strcmp(arg, "show-pass-cases"    ) == 0) cut_print_case_flags |= CUT_FLAG_PASS;
+    else if (strcmp(arg, "show-fail-cases"    ) == 0) cut_print_case_flags |= CUT_FLAG_FAIL;
+    else if (strcmp(arg, "show-skip-cases"    ) == 0) cut_print_case_flags |= CUT_FLAG_SKIP;
+    else if (strcmp(arg, "show-error-cases"   ) == 0) cut_print_case_flags |= CUT_FLAG_ERROR;
+    else if (strcmp(arg, "show-no-cases"      ) == 0) cut_print_case_flags  = 0;
+    else if (strcmp(arg, "no-show-cases"      ) == 0) cut_print_case_flags  = 0;
+    else if (strcmp(arg, "no-show-pass-cases" ) == 0) cut_print_case_flags &= ~CUT_FLAG_PASS;
+    else if (strcmp(arg, "no-show-fail-cases" ) == 0) cut_print_case_flags &= ~CUT_FLAG_FAIL;
+    else if (strcmp(arg, "no-show-skip-cases" ) == 0) cut_print_case_flags &= ~CUT_FLAG_SKIP;
+    else if (strcmp(arg, "no-show-error-cases") == 0) cut_print_case_flags &= ~CUT_FLAG_ERROR;
+    else if (strcmp(arg, "show-init-cases"    ) == 0) cut_print_init_cases = 1;
+    else if (strcmp(arg, "no-show-init-cases" ) == 0) cut_print_init_cases = 0;
+    else if (strcmp(arg, "show-resources"     ) == 0) cut_print_resources = 1;
+    else if (strcmp(arg, "no-show-resources"  ) == 0) cut_print_resources = 0;
+    else if (strcmp(arg, "perf-counters"      ) == 0) cut_perf_counters = 1;
+    else if (strcmp(arg, "no-perf-counters"   ) == 0) cut_perf_counters = 0;
+    else if (strcmp(arg, "track-allocations"  ) == 0) cut_track_allocations = 1;
+    else if (strcmp(arg, "no-track-allocations") == 0) cut_track_allocations = 0;
+    else if (strcmp(arg, "show-tests"         ) == 0) cut_print_test_flags  = CUT_FLAG_ALL;
+    else if (strcmp(arg, "show-pass-tests"    ) == 0) cut_print_test_flags |= CUT_FLAG_PASS;
+    else if (strcmp(arg, "show-fail-tests"    ) == 0) cut_print_test_flags |= CUT_FLAG_FAIL;
+    else if (strcmp(arg, "show-skip-tests"    ) == 0) cut_print_test_flags |= CUT_FLAG_SKIP;
+    else if (strcmp(arg, "show-error-tests"   ) == 0) cut_print_test_flags |= CUT_FLAG_ERROR;
+    else if (strcmp(arg, "show-no-tests"      ) == 0) cut_print_test_flags  = 0;
+    else if (strcmp(arg, "no-show-tests"      ) == 0) cut_print_test_flags  = 0;
+    else if (strcmp(arg, "no-show-pass-tests" ) == 0) cut_print_test_flags &= ~CUT_FLAG_PASS;
+    else if (strcmp(arg, "no-show-fail-tests" ) == 0) cut_print_test_flags &= ~CUT_FLAG_FAIL;
+    else if (strcmp(arg, "no-show-skip-tests" ) == 0) cut_print_test_flags &= ~CUT_FLAG_SKIP;
+    else if (strcmp(arg, "no-show-error-tests") == 0) cut_print_test_flags &= ~CUT_FLAG_ERROR;
+    else if (strcmp(arg, "isolate"            ) == 0) cut_isolate = 1;
+    else if (strcmp(arg, "no-isolate"         ) == 0) cut_isolate = 0;
+    else if (strcmp(arg, "forkserver"         ) == 0) cut_forkserver = 1;
+    else if (strcmp(arg, "no-forkserver"      ) == 0) cut_forkserver = 0;
+    else if (strcmp(arg, "history"            ) == 0) cut_history_file = cut_default_history_file();
+    else if (strcmp(arg, "no-history"         ) == 0) cut_history_file = NULL;
+    else if (strcmp(arg, "failed-first"       ) == 0) cut_failed_first = 1;
+    else if (strcmp(arg, "no-failed-first"    ) == 0) cut_failed_first = 0;
+    else if (strcmp(arg, "failed-only"        ) == 0) cut_failed_only = 1;
+    else if (strcmp(arg, "no-failed-only"     ) == 0) cut_failed_only = 0;
+    else if (strcmp(arg, "profile-assertions" ) == 0) cut_profile_assertions = 1;
+    else if (strcmp(arg, "no-profile-assertions") == 0) cut_profile_assertions = 0;
+    else if (strcmp(arg, "benchmark"          ) == 0) cut_benchmark = 1;
+    else if (strcmp(arg, "no-benchmark"       ) == 0) cut_benchmark = 0;
+    else if (strcmp(arg, "history-file") == 0)
+    {
+      arg_used = 2;
+
+      if (NULL == value)
+      {
+        fprintf(stderr, "cut: option -%s requires a value\n", arg);
+        result = CUT_RESULT_FAIL;
+      }
+      else
+      {
+        cut_history_file = value;
+      }
+    }
+    else if (strcmp(arg, "exclude") == 0)
+    {
+      const char** exclude = NULL;
+
+      arg_used = 2;
+
+      if (NULL == value)
+      {
+        fprintf(stderr, "cut: option -%s requires a value\n", arg);
+        result = CUT_RESULT_FAIL;
+      }
+      else if (NULL != (exclude = (const char**) cut_reserve(g_cut->exclude, &g_cut->exclude_size, g_cut->exclude_count + 1, sizeof(const char*))))
+      {
+        g_cut->exclude = exclude;
+        g_cut->exclude[g_cut->exclude_count++] = value;
+      }
+      else
+      {
+        result = CUT_RESULT_ERROR;
+      }
+    }
+    else if (strcmp(arg, "shard-index") == 0)
+    {
+      arg_used = 2;
+      if (CUT_RESULT_PASS != parse_int_option(arg, value, &cut_shard_index)) result = CUT_RESULT_FAIL;
+    }
+    else if (strcmp(arg, "shard-count") == 0)
+    {
+      arg_used = 2;
+      if (CUT_RESULT_PASS != parse_int_option(arg, value, &cut_shard_count)) result = CUT_RESULT_FAIL;
+    }
+    else if (strcmp(arg, "benchmark-msec") == 0)
+    {
+      arg_used = 2;
+      if (CUT_RESULT_PASS != parse_int_option(arg, value, &cut_benchmark_msec)) result = CUT_RESULT_FAIL;
+    }
+    else if (strcmp(arg, "benchmark-runs") == 0)
+    {
+      arg_used = 2;
+      if (CUT_RESULT_PASS != parse_int_option(arg, value, &cut_benchmark_runs)) result = CUT_RESULT_FAIL;
+    }
+    else if (strcmp(arg, "benchmark-baseline") == 0)
+    {
+      arg_used = 2;
+
+      if (NULL == value)
+      {
+        fprintf(stderr, "cut: option -%s requires a value\n", arg);
+        result = CUT_RESULT_FAIL;
+      }
+      else
+      {
+        cut_benchmark_baseline = value;
+      }
+    }
+    else if (strcmp(arg, "benchmark-save") == 0)
+    {
+      arg_used = 2;
+
+      if (NULL == value)
+      {
+        fprintf(stderr, "cut: option -%s requires a value\n", arg);
+        result = CUT_RESULT_FAIL;
+      }
+      else
+      {
+        cut_benchmark_save = value;
+      }
+    }
+    else if (strcmp(arg, "benchmark-threshold") == 0)
+    {
+      arg_used = 2;
+      if (CUT_RESULT_PASS != parse_int_option(arg, value, &cut_benchmark_threshold)) result = CUT_RESULT_FAIL;
+    }
+    else if (strcmp(arg, "benchmark-threads") == 0)
+    {
+      int counts[CUT_BENCHMARK_MAX_COUNTS];
+
+      arg_used = 2;
+
+      if (NULL == value)
+      {
+        fprintf(stderr, "cut: option -%s requires a value\n", arg);
+        result = CUT_RESULT_FAIL;
+      }
+      else if (0 == cut_parse_thread_counts(value, counts))
+      {
+        fprintf(stderr, "cut: invalid value '%s' for option -%s\n", value, arg);
+        result = CUT_RESULT_FAIL;
+      }
+      else
+      {
+        cut_benchmark_threads = value;
+      }
+    }
+    else if (strcmp(arg, "timeout") == 0)
+    {
+      arg_used = 2;
+      if (CUT_RESULT_PASS != parse_int_option(arg, value, &cut_timeout_msec)) result = CUT_RESULT_FAIL;
+    }
+    else if ((strcmp(arg, "jobs") == 0) || (strcmp(arg, "j") == 0))
+    {
+      arg_used = 2;
+      if (CUT_RESULT_PASS != parse_int_option(arg, value, &cut_jobs)) result = CUT_RESULT_FAIL;
+    }
+    else
+    {
+      arg_used = 0;
+    }
+
+    if (arg_used > *argc - i)
+    {
+      arg_used = *argc - i;
+    }
+
+    if (arg_used)
+    {
+      int j = 0;
+
+      /*
+       * Remove argument (and any value) from list.
+       */
+      for (j = i + arg_used; j < *argc; j++)
+      {
+        argv[j-arg_used] = argv[j];
+      }
+
+      (*argc) -= arg_used;
+      i--;
+    }
+  }   /* for each argument */
+
+  if ((cut_shard_count < 1) || (cut_shard_index >= cut_shard_count))
+  {
+    fprintf(stderr, "cut: -shard-index must be less than -shard-count\n");
+    result = CUT_RESULT_FAIL;
+  }
+
+  return result;
+}   /* cut_parse_command_line() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Prints cut-specific usage information to the given @a file, or to stdout
+ * if @a file is NULL.
+ */
+void cut_usage(FILE* file)
+{
+  fprintf(
+    file,
+    "  -[no-]show-cases              Do [not] show all test assertions.\n"
+    "  -[no-]show-[type]-cases       Turn on showing of assertions for result <type>.\n"
+    "  -show-no-cases                Same as -no-show-cases; shows no assertions.\n"
+    "  -[no-]show-init-cases         Do [not] show assertions from init functions.\n"
+    "  -[no-]show-resources          Do [not] show each test's time in ns, CPU time,\n"
+    "                                context switches and page faults.\n"
+    "  -[no-]perf-counters           Do [not] count each test's cycles, instructions,\n"
+    "                                and branch and cache misses (Linux only).\n"
+    "  -[no-]track-allocations       Do [not] count each test's heap allocations\n"
+    "                                and leaks.\n"
+    "  -[no-]show-tests              Do [not] show all test results.\n"
+    "  -[no-]show-[type]-tests       Turn on showing of test results for <type>.\n"
+    "  -show-no-tests                Same as -no-show-tests; shows no test results.\n"
+    "  -j, -jobs <n>                 Run tests on <n> threads; 0 uses one per CPU.\n"
+    "  -timeout <msec>               Report a test running over <msec> as an error;\n"
+    "                                0 is no limit.\n"
+    "  -[no-]history                 Do [not] keep test durations in\n"
+    "                                <program>" CUT_HISTORY_SUFFIX "; parallel runs start the\n"
+    "                                longest tests first.\n"
+    "  -history-file <file>          Keep test durations in <file>.\n"
+    "  -[no-]failed-first            Do [not] run tests that failed last time first.\n"
+    "  -[no-]failed-only             Do [not] run only tests that failed last time.\n"
+    "  -[no-]profile-assertions      Do [not] list each test's busiest assertions.\n"
+    "  -[no-]benchmark               Do [not] measure benchmarks; otherwise each one\n"
+    "                                runs once as a test.\n"
+    "  -benchmark-msec <msec>        Calibrate benchmarks to run at least <msec>.\n"
+    "  -benchmark-runs <n>           Time <n> runs of each benchmark.\n"
+    "  -benchmark-baseline <file>    Fail benchmarks significantly slower than the\n"
+    "                                runs in <file>...\n"
+    "  -benchmark-threshold <pct>    ...by more than <pct> percent.\n"
+    "  -benchmark-save <file>        Save the runs of benchmarks to <file>.\n"
+    "  -benchmark-threads <list>     Measure scaling benchmarks at the thread counts\n"
+    "                                in <list>, such as 1,2,4,8; the default is\n"
+    "                                powers of two up to the number of CPUs.\n"
+    "  -exclude <pattern>            Skip tests matching <pattern>; may be repeated.\n"
+    "  -shard-index <i>              Run only shard <i> (from 0) of the tests...\n"
+    "  -shard-count <n>              ...split into <n> shards.\n"
+    "  -[no-]isolate                 Do [not] run each test in its own process;\n"
+    "                                -jobs sets how many run at once.\n"
+    "  -[no-]forkserver              Do [not] fork each test's process from a\n"
+    "                                snapshot taken when cut_run() is called.\n"
+    "\n"
+    "  <type> - Result types may be pass, fail, skip, or error.\n"
+    "\n"
+    );
+}   /* cut_usage() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A node of the automaton that matches test selection patterns. Node 0 is
+ * the root; its transitions are kept in a table, all others in a list of
+ * children.
+ */
+typedef struct cut_match_node_s
+{
+  uint32_t child;     /**< First child, or 0. */
+  uint32_t sibling;   /**< Next child of the same parent, or 0. */
+  uint32_t fail;      /**< Longest proper suffix that is also a node. */
+  uint32_t output;    /**< Nearest node on the fail chain, this one included, that ends a pattern; or 0. */
+  uint32_t pattern;   /**< 1 + first pattern whose literal ends here, or 0. */
+  unsigned char c;    /**< Character leading to this node. */
+} cut_match_node_t;
+
+/**
+ * A test selection pattern, as compiled by cut_select().
+ */
+typedef struct cut_pattern_s
+{
+  char* glob;         /**< Glob to check against the full name, or NULL for a plain substring. */
+  const char* literal; /**< Start of the literal, within the glob or the original text. */
+  size_t length;      /**< Length of the literal fed to the automaton. */
+  uint32_t next;      /**< 1 + next pattern with the same literal, or 0. */
+  int exclude;        /**< Non-zero for a pattern that excludes tests. */
+  size_t last_test;   /**< 1 + last test matched, so a test counts once. */
+  int matched;        /**< Number of tests matched. */
+} cut_pattern_t;
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return non-zero if all of @a text matches @a glob, where '*' matches any
+ * run of characters and '?' matches any one character.
+ */
+static int cut_glob_match(const char* glob, const char* text)
+{
+  const char* star = NULL;
+  const char* retry = NULL;
+
+  while (0 != *text)
+  {
+    if (('?' == *glob) || (*glob == *text))
+    {
+      glob++;
+      text++;
+    }
+    else if ('*' == *glob)
+    {
+      star = ++glob;
+      retry = text;
+    }
+    else if (NULL != star)
+    {
+      glob = star;
+      text = ++retry;
+    }
+    else
+    {
+      return 0;
+    }
+  }
+
+  while ('*' == *glob)
+  {
+    glob++;
+  }
+
+  return 0 == *glob;
+}   /* cut_glob_match() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Compiles @a text into @a pattern. A leading '!' makes it exclude tests. A
+ * pattern with '*' or '?', or anchored with a leading '^' or trailing '$',
+ * must match the whole full name as a glob; any other pattern is a
+ * substring. The longest run of the pattern without wildcards becomes the
+ * literal that the automaton looks for.
+ *
+ * @return CUT_RESULT_PASS, or CUT_RESULT_ERROR if out of memory.
+ */
+static cut_result_t cut_compile_pattern(cut_pattern_t* pattern, const char* text, int exclude)
+{
+  size_t length = 0;
+  size_t start = 0;
+  size_t i = 0;
+  int anchor_start = 0;
+  int anchor_end = 0;
+
+  memset(pattern, 0, sizeof(*pattern));
+
+  if ('!' == *text)
+  {
+    exclude = 1;
+    text++;
+  }
+
+  pattern->exclude = exclude;
+
+  if ('^' == *text)
+  {
+    anchor_start = 1;
+    text++;
+  }
+
+  length = strlen(text);
+
+  if ((length > 0) && ('$' == text[length - 1]))
+  {
+    anchor_end = 1;
+    length--;
+  }
+
+  if (anchor_start || anchor_end || (strcspn(text, "*?") < length))
+  {
+    char* glob = (char*) malloc(length + 3);
+
+    if (NULL == glob)
+    {
+      return CUT_RESULT_ERROR;
+    }
+
+    i = 0;
+    if (!anchor_start && anchor_end) glob[i++] = '*';
+    memcpy(&glob[i], text, length);
+    i += length;
+    if (anchor_start && !anchor_end) glob[i++] = '*';
+    glob[i] = 0;
+    pattern->glob = glob;
+    text = glob;
+    length = i;
+  }
+
+  /*
+   * Find the longest literal run.
+   */
+  for (i = 0; i <= length; i++)
+  {
+    if ((i == length) || ((NULL != pattern->glob) && (('*' == text[i]) || ('?' == text[i]))))
+    {
+      if (i - start > pattern->length)
+      {
+        pattern->literal = &text[start];
+        pattern->length = i - start;
+      }
+
+      start = i + 1;
+    }
+  }
+
+  return CUT_RESULT_PASS;
+}   /* cut_compile_pattern() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return non-zero if some string that starts with @a text matches all of
+ * @a glob.
+ */
+static int cut_glob_match_start(const char* glob, const char* text)
+{
+  const char* star = NULL;
+  const char* retry = NULL;
+
+  while (0 != *text)
+  {
+    if ((0 != *glob) && (('?' == *glob) || (*glob == *text)))
+    {
+      glob++;
+      text++;
+    }
+    else if ('*' == *glob)
+    {
+      star = ++glob;
+      retry = text;
+    }
+    else if (NULL != star)
+    {
+      glob = star;
+      text = ++retry;
+    }
+    else
+    {
+      return 0;
+    }
+  }
+
+  return 1;
+}   /* cut_glob_match_start() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return non-zero if @a pattern might include a test of @a suite, judging
+ * only by the suite's prefix. A glob can be checked exactly. A substring
+ * without the delimiter may lie within any test's own name; one with it
+ * must fit the suite's prefix, since a test's own name is taken not to
+ * contain the delimiter.
+ */
+static int cut_pattern_may_match_suite(const cut_pattern_t* pattern, const cut_suite_t* suite)
+{
+  const char* text = pattern->literal;
+  size_t length = pattern->length;
+  size_t i = 0;
+
+  if (pattern->exclude)
+  {
+    return 0;
+  }
+
+  if (NULL != pattern->glob)
+  {
+    return cut_glob_match_start(pattern->glob, suite->prefix);
+  }
+
+  if (NULL == strstr(text, cut_name_delimiter))
+  {
+    return 1;
+  }
+
+  /*
+   * The pattern either lies within the prefix or starts within it and runs
+   * on into the test's own name.
+   */
+  for (i = 0; i < suite->prefix_length; i++)
+  {
+    size_t overlap = suite->prefix_length - i;
+
+    if (overlap >= length)
+    {
+      if (0 == strncmp(&suite->prefix[i], text, length))
+      {
+        return 1;
+      }
+    }
+    else if ((0 == strncmp(&suite->prefix[i], text, overlap)) &&
+             (NULL == strstr(&text[overlap], cut_name_delimiter)))
+    {
+      return 1;
+    }
+  }
+
+  return 0;
+}   /* cut_pattern_may_match_suite() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Calls the installer of each suite that has not been installed yet and
+ * might hold a test included by one of @a count @a patterns, or of every
+ * such suite if @a patterns is NULL. The data buffers that installers
+ * allocate are thus only allocated for suites that may run.
+ */
+static void cut_install_pending(const cut_pattern_t* patterns, size_t count)
+{
+  size_t s = 0;
+  size_t p = 0;
+
+  for (s = 0; s < g_cut->suite_count; s++)
+  {
+    cut_install_func_t install = g_cut->suite[s].install;
+    int wanted = (NULL == patterns);
+
+    for (p = 0; (p < count) && !wanted; p++)
+    {
+      wanted = cut_pattern_may_match_suite(&patterns[p], &g_cut->suite[s]);
+    }
+
+    if ((NULL == install) || !wanted)
+    {
+      continue;
+    }
+
+    /*
+     * The installer may add suites, which can move the array.
+     */
+    g_cut->suite[s].install = NULL;
+    g_cut->suite[s].first = g_cut->test_count;
+    g_cut->active_suite = &g_cut->suite[s];
+    install();
+  }
+
+  g_cut->active_suite = NULL;
+}   /* cut_install_pending() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Counts a match of @a pattern (index @a p) in test number @a t, after
+ * checking its glob against the full name of the test if it has one.
+ */
+static void cut_match_pattern(cut_pattern_t* patterns, uint32_t p, size_t t,
+                              int* include, int* exclude, char** buffer, size_t* size)
+{
+  cut_pattern_t* pattern = &patterns[p];
+
+  if (pattern->last_test == t + 1)
+  {
+    return;
+  }
+
+  if (NULL != pattern->glob)
+  {
+    const char* name = cut_format_test_name(&g_cut->test[t], buffer, size);
+
+    if ((NULL == name) || !cut_glob_match(pattern->glob, name))
+    {
+      return;
+    }
+  }
+
+  pattern->last_test = t + 1;
+  pattern->matched++;
+
+  if (pattern->exclude)
+  {
+    *exclude = 1;
+  }
+  else
+  {
+    *include = 1;
+  }
+}   /* cut_match_pattern() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Includes or excludes tests by @a count @a texts, all at once. The
+ * literals of all the patterns are compiled into one Aho-Corasick automaton,
+ * so each full name is scanned once no matter how many patterns there are;
+ * only names that contain a glob's literal are checked against the glob.
+ *
+ * A test matching an excluding pattern is excluded even if an including
+ * pattern also matches it. If any pattern includes tests and none did
+ * before, every test not included is excluded, as with cut_include_test().
+ *
+ * @param exclude - if non-zero, every pattern excludes tests.
+ * @param matched - if not NULL, receives the number of tests matched by each
+ * pattern.
+ */
+static cut_result_t cut_select(const char* const* texts, size_t count, int exclude, int* matched)
+{
+  cut_result_t result = CUT_RESULT_ERROR;
+  cut_pattern_t* patterns = NULL;
+  cut_match_node_t* nodes = NULL;
+  size_t nodes_size = 0;
+  uint32_t node_count = 1;
+  uint32_t root[256];
+  uint32_t* queue = NULL;
+  uint32_t always = 0;
+  char* buffer = NULL;
+  size_t size = 0;
+  int any_include = 0;
+  size_t p = 0;
+  size_t t = 0;
+  uint32_t i = 0;
+  uint32_t head = 0;
+  uint32_t tail = 0;
+
+  memset(root, 0, sizeof(root));
+
+  if ((CUT_RESULT_PASS != cut_install_static_tests()) ||
+      (0 == count) ||
+      (NULL == (patterns = (cut_pattern_t*) calloc(count, sizeof(cut_pattern_t)))) ||
+      (NULL == (nodes = (cut_match_node_t*) cut_reserve(NULL, &nodes_size, 1, sizeof(cut_match_node_t)))))
+  {
+    goto done;
+  }
+
+  memset(nodes, 0, sizeof(cut_match_node_t));
+
+  /*
+   * Build a trie of the literals. Patterns without one are checked against
+   * every test.
+   */
+  for (p = 0; p < count; p++)
+  {
+    cut_pattern_t* pattern = &patterns[p];
+    uint32_t node = 0;
+
+    if (CUT_RESULT_PASS != cut_compile_pattern(pattern, texts[p], exclude))
+    {
+      goto done;
+    }
+
+    any_include |= !pattern->exclude;
+
+    if (0 == pattern->length)
+    {
+      pattern->next = always;
+      always = (uint32_t) p + 1;
+      continue;
+    }
+
+    for (i = 0; i < pattern->length; i++)
+    {
+      unsigned char c = (unsigned char) pattern->literal[i];
+      uint32_t child = (0 == node) ? root[c] : nodes[node].child;
+
+      while ((0 != node) && (0 != child) && (nodes[child].c != c))
+      {
+        child = nodes[child].sibling;
+      }
+
+      if (0 == child)
+      {
+        cut_match_node_t* grown = (cut_match_node_t*) cut_reserve(nodes, &nodes_size, node_count + 1, sizeof(cut_match_node_t));
+
+        if (NULL == grown)
+        {
+          goto done;
+        }
+
+        nodes = grown;
+        child = node_count++;
+        memset(&nodes[child], 0, sizeof(cut_match_node_t));
+        nodes[child].c = c;
+
+        if (0 == node)
+        {
+          root[c] = child;
+        }
+        else
+        {
+          nodes[child].sibling = nodes[node].child;
+          nodes[node].child = child;
+        }
+      }
+
+      node = child;
+    }
+
+    pattern->next = nodes[node].pattern;
+    nodes[node].pattern = (uint32_t) p + 1;
+  }
+
+  cut_install_pending(patterns, count);
+
+  /*
+   * Link each node to its longest proper suffix in the trie, breadth
+   * first, so the suffix is always linked before the node.
+   */
+  if (NULL == (queue = (uint32_t*) malloc(node_count * sizeof(uint32_t))))
+  {
+    goto done;
+  }
+
+  for (i = 0; i < 256; i++)
+  {
+    if (0 != root[i])
+    {
+      queue[tail++] = root[i];
+    }
+  }
+
+  while (head < tail)
+  {
+    uint32_t node = queue[head++];
+    uint32_t child = 0;
+
+    nodes[node].output = (0 != nodes[node].pattern) ? node : nodes[nodes[node].fail].output;
+
+    for (child = nodes[node].child; 0 != child; child = nodes[child].sibling)
+    {
+      uint32_t fail = nodes[node].fail;
+      uint32_t next = 0;
+
+      for (;;)
+      {
+        next = (0 == fail) ? root[nodes[child].c] : nodes[fail].child;
+
+        while ((0 != fail) && (0 != next) && (nodes[next].c != nodes[child].c))
+        {
+          next = nodes[next].sibling;
+        }
+
+        if ((0 != next) || (0 == fail))
+        {
+          break;
+        }
+
+        fail = nodes[fail].fail;
+      }
+
+      nodes[child].fail = next;
+      queue[tail++] = child;
+    }
+  }
+
+  /*
+   * Classify each test in a single pass over its full name: the suite's
+   * prefix, then its own name.
+   */
+  for (t = 0; t < g_cut->test_count; t++)
+  {
+    const cut_suite_t* suite = cut_test_suite(&g_cut->test[t]);
+    const char* part[2];
+    int include_hit = 0;
+    int exclude_hit = 0;
+    uint32_t node = 0;
+    int k = 0;
+
+    part[0] = suite->prefix;
+    part[1] = g_cut->test_name[t];
+
+    for (k = 0; k < 2; k++)
+    {
+      const unsigned char* s = (const unsigned char*) part[k];
+
+      for (; 0 != *s; s++)
+      {
+        uint32_t next = 0;
+        uint32_t out = 0;
+
+        for (;;)
+        {
+          next = (0 == node) ? root[*s] : nodes[node].child;
+
+          while ((0 != node) && (0 != next) && (nodes[next].c != *s))
+          {
+            next = nodes[next].sibling;
+          }
+
+          if ((0 != next) || (0 == node))
+          {
+            break;
+          }
+
+          node = nodes[node].fail;
+        }
+
+        node = next;
+
+        for (out = nodes[node].output; 0 != out; out = nodes[nodes[out].fail].output)
+        {
+          for (i = nodes[out].pattern; 0 != i; i = patterns[i - 1].next)
+          {
+            cut_match_pattern(patterns, i - 1, t, &include_hit, &exclude_hit, &buffer, &size);
+          }
+        }
+      }
+    }
+
+    for (i = always; 0 != i; i = patterns[i - 1].next)
+    {
+      cut_match_pattern(patterns, i - 1, t, &include_hit, &exclude_hit, &buffer, &size);
+    }
+
+    if (exclude_hit)
+    {
+      g_cut->test[t].flags |= CUT_TEST_FLAG_EXCLUDE;
+    }
+    else if (include_hit)
+    {
+      g_cut->test[t].flags &= ~CUT_TEST_FLAG_EXCLUDE;
+    }
+    else if (any_include && !g_cut->include_test_called)
+    {
+      g_cut->test[t].flags |= CUT_TEST_FLAG_EXCLUDE;
+    }
+  }
+
+  if (any_include)
+  {
+    g_cut->include_test_called = 1;
+  }
+
+  result = CUT_RESULT_PASS;
+
+  for (p = 0; p < count; p++)
+  {
+    if (0 == patterns[p].matched)
+    {
+      result = CUT_RESULT_FAIL;
+    }
+
+    if (NULL != matched)
+    {
+      matched[p] = patterns[p].matched;
+    }
+  }
+
+done:
+  if (NULL != patterns)
+  {
+    for (p = 0; p < count; p++)
+    {
+      free(patterns[p].glob);
+    }
+  }
+
+  free(buffer);
+  free(queue);
+  free(nodes);
+  free(patterns);
+  return result;
+}   /* cut_select() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_select_tests(const char* const* patterns, size_t count, int* matched)
+{
+  if ((NULL == patterns) || (0 == count))
+  {
+    return CUT_RESULT_FAIL;
+  }
+
+  return cut_select(patterns, count, 0, matched);
+}   /* cut_select_tests() */
+
+/* ------------------------------------------------------------------------- */
+int cut_include_test(const char* substring) {
+  int matched = 0;
+
+  if (NULL == substring)
+  {
+    return 0;
+  }
+
+  (void) cut_select(&substring, 1, 0, &matched);
+  return matched;
+}   /* cut_include_test() */
+
+/* ------------------------------------------------------------------------- */
+int cut_exclude_test(const char* pattern) {
+  int matched = 0;
+
+  if (NULL == pattern)
+  {
+    return 0;
+  }
+
+  (void) cut_select(&pattern, 1, 1, &matched);
+  return matched;
+}   /* cut_exclude_test() */
+
+/*
+ * Messages sent from an isolated test process to the parent. Each is a
+ * cut_frame_t header followed by @a length bytes of payload.
+ */
+#define CUT_FRAME_TEXT     1   /**< Printed output. */
+#define CUT_FRAME_RESULT   2   /**< A cut_report_t; the test is complete. */
+#define CUT_FRAME_STATUS   3   /**< Wait status of the child, from a forkserver. */
+#define CUT_FRAME_PID      4   /**< Process ID of the child, sent when it starts. */
+#define CUT_FRAME_BENCHMARK 5  /**< Timed runs of a benchmark, as doubles. */
+
+typedef struct cut_frame_s
+{
+  uint32_t type;
+  uint32_t length;
+} cut_frame_t;
+
+/**
+ * Result of an isolated test, as sent to the parent.
+ */
+typedef struct cut_report_s
+{
+  int32_t result;
+  uint32_t assertions[CUT_RESULT_COUNT];
+  uint64_t usec;
+  uint32_t perf_have;
+  uint64_t perf[CUT_PERF_PHASES][CUT_PERF_COUNT];
+} cut_report_t;
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Writes a message of @a type with @a length bytes of @a payload to @a fd.
+ * Errors are ignored; the parent reports a test that fails to deliver its
+ * result.
+ */
+static void cut_write_frame(int fd, uint32_t type, const void* payload, size_t length)
+{
+#if defined(_WIN32)
+  (void) fd; (void) type; (void) payload; (void) length;
+#else
+  cut_frame_t frame;
+  const char* p = (const char*) &frame;
+  size_t left = sizeof(frame);
+  int part = 0;
+
+  frame.type = type;
+  frame.length = (uint32_t) length;
+
+  for (part = 0; part < 2; part++)
+  {
+    while (left > 0)
+    {
+      ssize_t n = write(fd, p, left);
+
+      if (n < 0)
+      {
+        if (EINTR == errno) continue;
+        return;
+      }
+
+      p += n;
+      left -= n;
+    }
+
+    p = (const char*) payload;
+    left = length;
+  }
+#endif
+}   /* cut_write_frame() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Writes any buffered output for @a worker to stdout as a single unit, or
+ * sends it to the parent process for isolated tests.
+ */
+static void cut_flush_worker(cut_worker_t* worker)
+{
+  assert(NULL != worker);
+
+  if (worker->report && (worker->out_len > 0))
+  {
+    cut_write_frame(worker->report_fd, CUT_FRAME_TEXT, worker->out, worker->out_len);
+  }
+  else if (worker->buffered && (worker->out_len > 0))
+  {
+    cut_mutex_lock(&g_cut->lock);
+    fwrite(worker->out, 1, worker->out_len, stdout);
+    fflush(stdout);
+    cut_mutex_unlock(&g_cut->lock);
+  }
+
+  worker->out_len = 0;
+}   /* cut_flush_worker() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Prints to stdout on behalf of @a worker, or to the worker's output buffer
+ * if its output is buffered.
+ */
+static void cut_printf(cut_worker_t* worker, const char* format, ...) CUT_GNU_ATTRIBUTE((format(printf,2,3)));
+static void cut_printf(cut_worker_t* worker, const char* format, ...)
+{
+  va_list va;
+
+  assert(NULL != worker);
+  assert(NULL != format);
+
+  va_start(va, format);
+
+  if (!worker->buffered)
+  {
+    vprintf(format, va);
+  }
+  else
+  {
+    va_list vb;
+    int len = 0;
+
+    va_copy(vb, va);
+    len = vsnprintf(NULL, 0, format, vb);
+    va_end(vb);
+
+    if (len > 0)
+    {
+      if (worker->out_len + len + 1 > worker->out_size)
+      {
+        size_t size = (worker->out_size > 0) ? worker->out_size : 0x400;
+        char* out = NULL;
+
+        while (worker->out_len + len + 1 > size)
+        {
+          size *= 2;
+        }
+
+        out = (char*) realloc(worker->out, size);
+
+        if (NULL == out)
+        {
+          va_end(va);
+          return;
+        }
+
+        worker->out = out;
+        worker->out_size = size;
+      }
+
+      vsnprintf(&worker->out[worker->out_len], worker->out_size - worker->out_len, format, va);
+      worker->out_len += len;
+
+      /*
+       * Isolated tests send each completed line right away so that nothing
+       * printed before a crash is lost.
+       */
+      if (worker->report && ('\n' == worker->out[worker->out_len - 1]))
+      {
+        cut_flush_worker(worker);
+      }
+    }
+  }
+
+  va_end(va);
+}   /* cut_printf() */
+
+/* ------------------------------------------------------------------------- */
+static cut_wrap_init_func_t g_cut_wrap_init = NULL;
+static cut_wrap_exit_func_t g_cut_wrap_exit = NULL;
+static cut_wrap_test_func_t g_cut_wrap_test = NULL;
+static void* g_cut_wrap_cookie = NULL;
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Sets the wrapper functions to be used when calling into a test suite. This
+ * is provided so that the C++ wrapper may catch exceptions and indicate an
+ * error or failure.
+ */
+void cut_set_wrapper(cut_wrap_init_func_t wrap_init,
+                     cut_wrap_exit_func_t wrap_exit,
+                     cut_wrap_test_func_t wrap_test,
+                     void* wrapper_cookie)
+{
+  g_cut_wrap_init = wrap_init;
+  g_cut_wrap_exit = wrap_exit;
+  g_cut_wrap_test = wrap_test;
+  g_cut_wrap_cookie = wrapper_cookie;
+}   /* cut_set_wrapper() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return non-zero if an assertion made by @a worker is to be counted, and
+ * so printed if cut_print_case_flags asks for it.
+ * Assertions made in an init function are not, unless cut_print_init_cases
+ * is set.
+ */
+static int cut_case_counted(const cut_worker_t* worker)
+{
+  return (NULL != worker->active_test) || cut_print_init_cases;
+}   /* cut_case_counted() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return non-zero if an assertion with @a result made by @a worker will be
+ * printed, so that its message is needed.
+ */
+static int cut_case_printed(const cut_worker_t* worker, cut_result_t result)
+{
+  return cut_case_counted(worker) && (cut_print_case_flags & CUT_RESULT_FLAG(result));
+}   /* cut_case_printed() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the result of an assertion of @a condition made by @a worker: a
+ * false condition is a failure in a test but an error in an init function.
+ */
+static cut_result_t cut_condition_result(const cut_worker_t* worker, int condition)
+{
+  assert(NULL != worker->active_suite);
+
+  if (condition)
+  {
+    return CUT_RESULT_PASS;
+  }
+
+  return (NULL != worker->active_test) ? CUT_RESULT_FAIL : CUT_RESULT_ERROR;
+}   /* cut_condition_result() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Finds the counts for @a file:@a line in @a test in @a table, adding them
+ * if they are not there yet. Only the address of @a file is used, so the
+ * same name at two addresses makes two entries; they are combined when the
+ * profile is printed.
+ *
+ * @return the counts, or NULL if out of memory.
+ */
+static cut_site_count_t* cut_site_find(cut_site_table_t* table, const char* file, int line, const cut_test_t* test)
+{
+  cut_site_count_t* slot = NULL;
+  size_t mask = 0;
+  size_t i = 0;
+
+  if (2 * (table->count + 1) > table->size)
+  {
+    cut_site_table_t grown;
+    size_t j = 0;
+
+    grown.size = (table->size > 0) ? 2 * table->size : 0x40;
+    grown.count = 0;
+    grown.slot = (cut_site_count_t*) calloc(grown.size, sizeof(cut_site_count_t));
+
+    if (NULL == grown.slot)
+    {
+      return NULL;
+    }
+
+    for (j = 0; j < table->size; j++)
+    {
+      if (NULL != table->slot[j].file)
+      {
+        slot = cut_site_find(&grown, table->slot[j].file, table->slot[j].line, table->slot[j].test);
+        *slot = table->slot[j];
+      }
+    }
+
+    free(table->slot);
+    *table = grown;
+  }
+
+  mask = table->size - 1;
+  i = (size_t) ((((uintptr_t) file >> 3) ^ ((uintptr_t) test >> 4) ^ ((uintptr_t) line * 0x9E3779B1u)) & mask);
+
+  for (slot = &table->slot[i]; NULL != slot->file; slot = &table->slot[i])
+  {
+    if ((slot->file == file) && (slot->line == line) && (slot->test == test))
+    {
+      return slot;
+    }
+
+    i = (i + 1) & mask;
+  }
+
+  slot->file = file;
+  slot->line = line;
+  slot->test = test;
+  table->count++;
+  return slot;
+}   /* cut_site_find() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Adds the counts in @a from to those in @a to, then empties @a from.
+ */
+static void cut_site_merge(cut_site_table_t* to, cut_site_table_t* from)
+{
+  size_t i = 0;
+  int r = 0;
+
+  for (i = 0; i < from->size; i++)
+  {
+    const cut_site_count_t* site = &from->slot[i];
+    cut_site_count_t* sum = NULL;
+
+    if ((NULL == site->file) || (NULL == (sum = cut_site_find(to, site->file, site->line, site->test))))
+    {
+      continue;
+    }
+
+    for (r = CUT_RESULT_FIRST; r <= CUT_RESULT_LAST; r++)
+    {
+      sum->count[r] += site->count[r];
+    }
+
+    sum->usec += site->usec;
+  }
+
+  free(from->slot);
+  memset(from, 0, sizeof(*from));
+}   /* cut_site_merge() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Counts an assertion with @a result at @a file:@a line in @a worker's
+ * running test, charging it with the time since the test's previous
+ * assertion.
+ */
+static void cut_profile_assertion(cut_worker_t* worker, const char* file, int line, cut_result_t result)
+{
+  cut_site_count_t* site = NULL;
+  usec_t now = 0;
+
+  if ((NULL == worker->active_test) || (NULL == file))
+  {
+    return;
+  }
+
+  now = usec_time();
+  site = cut_site_find(&worker->sites, file, line, worker->active_test);
+
+  if (NULL != site)
+  {
+    site->count[result]++;
+    site->usec += now - worker->site_time;
+  }
+
+  worker->site_time = now;
+}   /* cut_profile_assertion() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Registers the result of an assertion.
+ * All of the other assertion functions and macros end up calling this.
+ */
+cut_result_t cut_assertion_result(const char*  file,
+                                  int          line,
+                                  cut_result_t result,
+                                  const char*  message)
+{
+  cut_worker_t* worker = g_cut_worker;
+  cut_alloc_stats_t* allocs = g_cut_allocs;
+  int alloc_depth = g_cut_alloc_depth;
+
+  assert((result >= CUT_RESULT_FIRST) && (result <= CUT_RESULT_LAST));
+  assert(NULL != worker);
+
+  /*
+   * Memory used for printing and profiling is not the test's.
+   */
+  g_cut_allocs = NULL;
+  g_cut_alloc_depth = 0;
+
+  /*
+   * Do not include assertions in init function.
+   */
+  if (cut_case_counted(worker))
+  {
+    worker->assertions[result]++;
+
+    if (cut_profile_assertions)
+    {
+      cut_profile_assertion(worker, file, line, result);
+    }
+
+    if (cut_print_case_flags & CUT_RESULT_FLAG(result))
+    {
+      if (worker->test_name_hanging)
+      {
+        cut_printf(worker, "\n");
+        worker->test_name_hanging = 0;
+      }
+
+      cut_printf(worker, "%s:%d: %-5s %s\n", file, line, cut_result_name[result], message);
+    }
+  }
+
+  g_cut_allocs = allocs;
+  g_cut_alloc_depth = alloc_depth;
+  return result;
+}   /* cut_assertion_result() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Makes an assertion for the currently running test or test_init() function.
+ * All of the other assertion functions and macros end up calling this.
+ */
+cut_result_t cut_assert(const char* file,
+                        int         line,
+                        int         condition,
+                        const char* message)
+{
+  cut_worker_t* worker = g_cut_worker;
+
+  assert(NULL != worker);
+
+  return cut_assertion_result(file, line, cut_condition_result(worker, condition), message);
+}   /* cut_assert() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assertf(const char* file,
+                         int         line,
+                         int         condition,
+                         const char* format,
+                         ...)
+{
+  char message[0x100] = "";
+  cut_worker_t* worker = g_cut_worker;
+  cut_result_t result = CUT_RESULT_PASS;
+  va_list va;
+
+  assert(NULL != worker);
+  result = cut_condition_result(worker, condition);
+
+  /*
+   * Most assertions pass and are never printed; only format the message
+   * when it will be.
+   */
+  if (cut_case_printed(worker, result))
+  {
+    va_start(va, format);
+    vsnprintf(message, sizeof(message), format, va);
+    va_end(va);
+    message[sizeof(message) - 1] = 0;
+  }
+
+  return cut_assertion_result(file, line, result, message);
+}   /* cut_assertf() */
+
+/* ------------------------------------------------------------------------- */
+CUT_THREAD_LOCAL unsigned int cut_fast_passes = 0;
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_site(const cut_site_t* site, int condition)
+{
+  assert(NULL != site);
+  return cut_assert(site->file, site->line, condition, site->text);
+}   /* cut_assert_site() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_site_int_in(const cut_site_t* site, cut_int_t lo, cut_int_t hi, cut_int_t actual)
+{
+  assert(NULL != site);
+  return cut_assert_int_in(site->file, site->line, lo, hi, actual, site->text);
+}   /* cut_assert_site_int_in() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_site_pointer(const cut_site_t* site, const void* proper, const void* actual)
+{
+  assert(NULL != site);
+  return cut_assert_pointer(site->file, site->line, proper, actual, site->text);
+}   /* cut_assert_site_pointer() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_site_double_in(const cut_site_t* site, double lo, double hi, double actual)
+{
+  assert(NULL != site);
+  return cut_assert_double_in(site->file, site->line, lo, hi, actual, site->text);
+}   /* cut_assert_site_double_in() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Adds the fast assertions passed on this thread to @a worker's counts, if
+ * assertions are being counted, and starts the count over.
+ */
+static void cut_collect_fast_passes(cut_worker_t* worker)
+{
+  if (cut_case_counted(worker))
+  {
+    worker->assertions[CUT_RESULT_PASS] += cut_fast_passes;
+  }
+
+  cut_fast_passes = 0;
+}   /* cut_collect_fast_passes() */
+
+/**
+ * String used to separate the actual value from any extra message.
+ */
+#define CUT_EXTRA_MESSAGE_PAD   " - "
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_pointer(const char* file, int line, const void* proper, const void* actual,
+                                const char* extra_message)
+{
+  return cut_assertf(file, line, proper == actual, "\n  Proper: @%p\n  Actual: @%p%s%s", proper, actual,
+                     (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                     (extra_message == NULL) ? "" : extra_message);
+}   /* cut_assert_pointer() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * If @a lo greater than @a hi, swap them.
+ */
+#define CHECK_LO_HI(_type,_lo,_hi) \
+  do {                             \
+    if (_hi < _lo) {               \
+      _type _temp = _lo;           \
+      _lo = _hi;                   \
+      _hi = _temp;                 \
+    }                              \
+  } while (0)
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_int_in(const char* file, int line, long long proper_lo, long long proper_hi, long long actual,
+                               const char* extra_message)
+{
+  const char* comparison_text = (actual < proper_lo) ? " (< Lower)" : ((actual > proper_hi) ? " (> Upper)" : "");
+#define MINGW 0
+#if defined(MINGW)
+  if (proper_lo == proper_hi)
+  {
+    return cut_assertf(file, line, proper_lo == actual,
+                       "\n  Proper: %10ld (0x%08lX)\n  Actual: %10ld (0x%08lX)%s%s",
+                       (long) proper_lo, (long) proper_lo, (long) actual, (long) actual,
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message);
+  }
+  else
+  {
+    CHECK_LO_HI(long long, proper_lo, proper_hi);
+    return cut_assertf(file, line, (proper_lo <= actual) && (actual <= proper_hi),
+                       "\n  Lower:  %10ld (0x%08lX)\n  Actual: %10ld (0x%08lX)%s%s%s\n  Upper:  %10ld (0x%08lX)",
+                       (long) proper_lo, (long) proper_lo,
+                       (long) actual, (long) actual, comparison_text,
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message,
+                       (long) proper_hi, (long) proper_hi);
+  }
+#else
+  if (proper_lo == proper_hi)
+  {
+    return cut_assertf(file, line, proper_lo == actual,
+                       "\n  Proper: %10lld (0x%08llX)\n  Actual: %10lld (0x%08llX)%s%s",
+                       proper_lo, proper_lo, actual, actual,
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message);
+  }
+  else
+  {
+    CHECK_LO_HI(long long, proper_lo, proper_hi);
+    return cut_assertf(file, line, (proper_lo <= actual) && (actual <= proper_hi),
+                       "\n  Lower:  %10lld (0x%08llX)\n  Actual: %10lld (0x%08llX)%s%s%s\n  Upper:  %10lld (0x%08llX)",
+                       proper_lo, proper_lo, actual, actual, comparison_text,
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message,
+                       proper_hi, proper_hi);
+  }
+#endif
+}   /* cut_assert_int_in() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_double_in(const char* file, int line, double proper_lo, double proper_hi, double actual,
+                                  const char* extra_message)
+{
+  if (proper_lo == proper_hi)
+  {
+    return cut_assertf(file, line, proper_lo == actual,
+                       "\n  Proper: %18.15E (%g)\n  Actual: %18.15E (%g)%s%s",
+                       proper_lo, proper_lo, actual, actual,
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message);
+  }
+  else
+  {
+    CHECK_LO_HI(double, proper_lo, proper_hi);
+    const char* comparison_text = (actual < proper_lo) ? " (< Lower)" : ((proper_hi < actual) ? " (> Upper)" : "");
+    return cut_assertf(file, line, (proper_lo <= actual) && (actual <= proper_hi),
+                       "\n  Lower:  %18.15E (%g)\n  Actual: %18.15E (%g)%s%s%s\n  Upper:  %18.15E (%g)",
+                       proper_lo, proper_lo, actual, actual, comparison_text,
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message,
+                       proper_hi, proper_hi);
+  }
+}   /* cut_assert_double_in() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_string(const char* file, int line, const char* proper, const char* actual,
+                               const char* extra_message)
+{
+  size_t plen = 0;
+  size_t alen = 0;
+  size_t max_len = 0;
+  size_t i = 0;
+
+  /*
+   * Handle the NULL cases first.
+   */
+  if ((NULL == proper) && (NULL == actual))
+  {
+    return cut_assertf(file, line, 1, "\n  Proper: NULL\n  Actual: NULL%s%s",
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message);
+  }
+  else if (NULL == proper)
+  {
+    return cut_assertf(file, line, 0, "\n  Proper: NULL\n  Actual: non-NULL%s%s",
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message);
+  }
+  else if (NULL == actual)
+  {
+    return cut_assertf(file, line, 0, "\n  Proper: non-NULL\n  Actual: NULL%s%s",
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message);
+  }
+
+  plen = strlen(proper);
+  alen = strlen(actual);
+
+  /*
+   * Eventually I need to do the pretty string slice printing, but for now I
+   * just run the memory comparison, being careful to check up to the
+   * readable portion of either.
+   */
+/*   if (alen < plen) */
+/*   { */
+/*     return cut_assert_memory(file, line, proper, actual, alen + 1); */
+/*   } */
+
+/*   return cut_assert_memory(file, line, proper, actual, plen); */
+
+  max_len = plen > alen ? plen : alen;
+  max_len++;   /* Include terminating NUL. */
+
+  for (i = 0; i < max_len; i++)
+  {
+    if (proper[i] != actual[i])
+    {
+      char pcimg[CHAR_IMAGE_MAX_LEN] = "";
+      char acimg[CHAR_IMAGE_MAX_LEN] = "";
+      char pdiff[PRINTABLE_DIFF_STRING_MAX_LEN] = "";
+      char adiff[PRINTABLE_DIFF_STRING_MAX_LEN] = "";
+
+      return cut_assertf(file, line, 0,
+                         "\n  Proper at [%d]: 0x%02X %3d %-6s \"%s\"\n  Actual at [%d]: 0x%02X %3d %-6s \"%s\"%s%s",
+                         (int) i, (unsigned) proper[i], (unsigned) proper[i], char_image(proper[i], pcimg),
+                         printable_diff_string(pdiff, proper, plen, i),
+                         (int) i, (unsigned) actual[i], (unsigned) actual[i], char_image(actual[i], acimg),
+                         printable_diff_string(adiff, actual, alen, i),
+                         (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                         (extra_message == NULL) ? "" : extra_message);
+    }
+  }
+
+  return cut_assertf(file, line, 1, "strings of length %d (0x%02X) match%s%s", (int) plen, (int) plen,
+                     (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                     (extra_message == NULL) ? "" : extra_message);
+}   /* cut_assert_string() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_memory(const char* file, int line, const void* proper, const void* actual, size_t n,
+                               const char* extra_message)
+{
+  size_t i = 0;
+  const unsigned char* p = (const unsigned char*) proper;
+  const unsigned char* a = (const unsigned char*) actual;
+
+  /*
+   * Handle the NULL cases first.
+   */
+  if ((NULL == proper) && (NULL == actual))
+  {
+    return cut_assertf(file, line, 1, "\n  Proper: NULL\n  Actual: NULL%s%s",
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message);
+  }
+  else if (NULL == proper)
+  {
+    return cut_assertf(file, line, 0, "\n  Proper: NULL\n  Actual: non-NULL%s%s",
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message);
+  }
+  else if (NULL == actual)
+  {
+    return cut_assertf(file, line, 0, "\n  Proper: non-NULL\n  Actual: NULL%s%s",
+                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                       (extra_message == NULL) ? "" : extra_message);
+  }
+
+  for (i = 0; i < n; i++)
+  {
+    if (p[i] != a[i])
+    {
+      char pcimg[CHAR_IMAGE_MAX_LEN] = "";
+      char acimg[CHAR_IMAGE_MAX_LEN] = "";
+
+      return cut_assertf(file, line, 0,
+                         "\n  Proper at [%d]: 0x%02X (%d, %s)\n  Actual at [%d]: 0x%02X (%d, %s)%s%s",
+                         (int) i, p[i], p[i], char_image(p[i], pcimg),
+                         (int) i, a[i], a[i], char_image(a[i], acimg),
+                         (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                         (extra_message == NULL) ? "" : extra_message);
+    }
+  }
+
+  return cut_assertf(file, line, 1, "buffers of length %d (0x%02X) match%s%s", (int) n, (int) n,
+                     (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
+                     (extra_message == NULL) ? "" : extra_message);
+}   /* cut_assert_memory() */
+
+/* ------------------------------------------------------------------------- */
+void cut_histogram_clear(cut_histogram_t* histogram)
+{
+  assert(NULL != histogram);
+  memset(histogram, 0, sizeof(*histogram));
+}   /* cut_histogram_clear() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the index of the bucket of @a value.
+ */
+static int cut_histogram_index(unsigned long long value)
+{
+  int shift = 0;
+
+  if (value < (1ULL << CUT_HISTOGRAM_SUB_BITS))
+  {
+    return (int) value;
+  }
+
+  if (value >= (1ULL << CUT_HISTOGRAM_MAX_BITS))
+  {
+    return CUT_HISTOGRAM_BUCKETS - 1;
+  }
+
+#if defined(__GNUC__)
+  shift = 63 - __builtin_clzll(value) - CUT_HISTOGRAM_SUB_BITS;
+#else
+  while ((value >> (shift + CUT_HISTOGRAM_SUB_BITS + 1)) != 0)
+  {
+    shift++;
+  }
+#endif
+
+  return ((shift + 1) << CUT_HISTOGRAM_SUB_BITS) + (int) ((value >> shift) - (1ULL << CUT_HISTOGRAM_SUB_BITS));
+}   /* cut_histogram_index() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the largest value that falls in bucket @a index.
+ */
+static unsigned long long cut_histogram_top(int index)
+{
+  int shift = (index >> CUT_HISTOGRAM_SUB_BITS) - 1;
+  unsigned long long mantissa = 0;
+
+  if (shift < 0)
+  {
+    return (unsigned long long) index;
+  }
+
+  mantissa = (1ULL << CUT_HISTOGRAM_SUB_BITS) + (index & ((1 << CUT_HISTOGRAM_SUB_BITS) - 1));
+  return ((mantissa + 1) << shift) - 1;
+}   /* cut_histogram_top() */
+
+/* ------------------------------------------------------------------------- */
+void cut_histogram_record(cut_histogram_t* histogram, unsigned long long value)
+{
+  assert(NULL != histogram);
+
+  if ((0 == histogram->count) || (value < histogram->min))
+  {
+    histogram->min = value;
+  }
+
+  if (value > histogram->max)
+  {
+    histogram->max = value;
+  }
+
+  histogram->count++;
+  histogram->sum += (double) value;
+  histogram->bucket[cut_histogram_index(value)]++;
+}   /* cut_histogram_record() */
+
+/* ------------------------------------------------------------------------- */
+void cut_histogram_merge(cut_histogram_t* to, const cut_histogram_t* from)
+{
+  int i = 0;
+
+  assert(NULL != to);
+  assert(NULL != from);
+
+  if (0 == from->count)
+  {
+    return;
+  }
+
+  if ((0 == to->count) || (from->min < to->min))
+  {
+    to->min = from->min;
+  }
+
+  if (from->max > to->max)
+  {
+    to->max = from->max;
+  }
+
+  to->count += from->count;
+  to->sum += from->sum;
+
+  for (i = 0; i < CUT_HISTOGRAM_BUCKETS; i++)
+  {
+    to->bucket[i] += from->bucket[i];
+  }
+}   /* cut_histogram_merge() */
+
+/* ------------------------------------------------------------------------- */
+unsigned long long cut_histogram_percentile(const cut_histogram_t* histogram, double percentile)
+{
+  unsigned long long rank = 0;
+  unsigned long long seen = 0;
+  double exact = 0.0;
+  int i = 0;
+
+  assert(NULL != histogram);
+
+  if (0 == histogram->count)
+  {
+    return 0;
+  }
+
+  if (percentile <= 0.0)
+  {
+    return histogram->min;
+  }
+
+  if (percentile >= 100.0)
+  {
+    return histogram->max;
+  }
+
+  /*
+   * The value of rank ceil(percentile% of count), counting from 1.
+   */
+  exact = percentile * (double) histogram->count / 100.0;
+  rank = (unsigned long long) exact;
+  rank += ((double) rank < exact) ? 1 : 0;
+  rank += (0 == rank) ? 1 : 0;
+
+  for (i = 0; i < CUT_HISTOGRAM_BUCKETS; i++)
+  {
+    seen += histogram->bucket[i];
+
+    if (seen >= rank)
+    {
+      unsigned long long top = cut_histogram_top(i);
+      return (top < histogram->min) ? histogram->min : (top > histogram->max) ? histogram->max : top;
+    }
+  }
+
+  return histogram->max;
+}   /* cut_histogram_percentile() */
+
+/**
+ * Percentiles shown by cut_histogram_print() and failed percentile
+ * assertions.
+ */
+static const double cut_histogram_table[] = { 0.0, 50.0, 75.0, 90.0, 95.0, 99.0, 99.9, 99.99, 100.0 };
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Writes the short name of @a percentile, such as "p99" or "max", into
+ * @a label, which holds @a size characters.
+ */
+static void cut_percentile_label(char* label, size_t size, double percentile)
+{
+  if (percentile <= 0.0)
+  {
+    snprintf(label, size, "min");
+  }
+  else if (percentile >= 100.0)
+  {
+    snprintf(label, size, "max");
+  }
+  else
+  {
+    snprintf(label, size, "p%g", percentile);
+  }
+}   /* cut_percentile_label() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Formats the percentile table of @a histogram into @a text, which holds
+ * @a size characters, starting each line with @a indent.
+ *
+ * @return the length of the text.
+ */
+static size_t cut_histogram_format(char* text, size_t size, const cut_histogram_t* histogram, const char* indent)
+{
+  size_t len = 0;
+  size_t i = 0;
+
+#define CUT_HISTOGRAM_APPEND(...)                                            \
+  do {                                                                       \
+    int _n = snprintf(text + len, (len < size) ? size - len : 0, __VA_ARGS__); \
+    len += (_n > 0) ? (size_t) _n : 0;                                       \
+  } while (0)
+
+  CUT_HISTOGRAM_APPEND("%s%llu values, mean %.1f", indent, histogram->count,
+                       (histogram->count > 0) ? histogram->sum / (double) histogram->count : 0.0);
+
+  for (i = 0; i < sizeof(cut_histogram_table) / sizeof(cut_histogram_table[0]); i++)
+  {
+    char label[0x20] = "";
+
+    cut_percentile_label(label, sizeof(label), cut_histogram_table[i]);
+    CUT_HISTOGRAM_APPEND("\n%s%8s %14llu", indent, label, cut_histogram_percentile(histogram, cut_histogram_table[i]));
+  }
+
+#undef CUT_HISTOGRAM_APPEND
+
+  return len;
+}   /* cut_histogram_format() */
+
+/* ------------------------------------------------------------------------- */
+void cut_histogram_print(FILE* file, const cut_histogram_t* histogram, const char* indent)
+{
+  char text[0x400] = "";
+
+  assert(NULL != file);
+  assert(NULL != histogram);
+
+  cut_histogram_format(text, sizeof(text), histogram, (NULL == indent) ? "" : indent);
+  fprintf(file, "%s\n", text);
+}   /* cut_histogram_print() */
+
+/* ------------------------------------------------------------------------- */
+cut_result_t cut_assert_percentile(const char* file, int line, const cut_histogram_t* histogram, double percentile,
+                                   unsigned long long max, const char* text)
+{
+  char message[0x400] = "";
+  cut_worker_t* worker = g_cut_worker;
+  unsigned long long actual = 0;
+  cut_result_t result = CUT_RESULT_PASS;
+  int len = 0;
+
+  assert(NULL != worker);
+  assert(NULL != histogram);
+
+  actual = cut_histogram_percentile(histogram, percentile);
+  result = cut_condition_result(worker, actual <= max);
+
+  if (cut_case_printed(worker, result))
+  {
+    char label[0x20] = "";
+
+    cut_percentile_label(label, sizeof(label), percentile);
+    len = snprintf(message, sizeof(message), "%s of %s is %llu, at most %llu%s", label,
+                   (NULL == text) ? "histogram" : text, actual, max, (CUT_RESULT_PASS == result) ? "" : ":\n");
+
+    if ((CUT_RESULT_PASS != result) && (len > 0) && ((size_t) len < sizeof(message)))
+    {
+      cut_histogram_format(message + len, sizeof(message) - len, histogram, "  ");
+    }
+  }
+
+  return cut_assertion_result(file, line, result, message);
+}   /* cut_assert_percentile() */
+
+/* ------------------------------------------------------------------------- */
+void cut_print_summary(FILE* file, cut_result_t result)
+{
+  size_t total_assertions = 0;
+  size_t total_tests = 0;
+  int i = 0;
+
+  assert(NULL != file);
+  assert((CUT_RESULT_FIRST <= result) && (result <= CUT_RESULT_LAST));
+
+  fprintf(file, "%12s", "");
+
+  for (i = CUT_RESULT_FIRST; i <= CUT_RESULT_LAST; i++)
+  {
+    fprintf(file, " %7s", cut_result_name[i]);
+  }
+
+  fprintf(file, " %8s", "Total");
+  fprintf(file, "\n");
+
+  fprintf(file, "%-12s", "Assertions");
+
+  for (i = CUT_RESULT_FIRST; i <= CUT_RESULT_LAST; i++)
+  {
+    total_assertions += g_cut->assertions[i];
+    fprintf(file, " %7d", g_cut->assertions[i]);
+  }
+
+  fprintf(file, " %8d\n", (int) total_assertions);
+
+  fprintf(file, "%-12s", "Tests");
+
+  for (i = CUT_RESULT_FIRST; i <= CUT_RESULT_LAST; i++)
+  {
+    total_tests += g_cut->tests[i];
+    fprintf(file, " %7d", g_cut->tests[i]);
+  }
+
+  fprintf(file, " %8d\n", (int) total_tests);
+
+  if (0 != g_cut->perf_have)
+  {
+    fprintf(file, "%-14s %16s %16s %16s\n", "Counters", "init", "test", "exit");
+
+    for (i = 0; i < CUT_PERF_COUNT; i++)
+    {
+      if (g_cut->perf_have & (1u << i))
+      {
+        fprintf(file, "%-14s %16llu %16llu %16llu\n", cut_perf_name[i],
+                (unsigned long long) g_cut->perf_total[CUT_PERF_INIT][i],
+                (unsigned long long) g_cut->perf_total[CUT_PERF_TEST][i],
+                (unsigned long long) g_cut->perf_total[CUT_PERF_EXIT][i]);
+      }
+    }
+  }
+
+  fprintf(file, "Result: %s\n", cut_result_name[result]);
+}   /* cut_print_summary() */
+
+/* ------------------------------------------------------------------------- */
+static void cut_print_test_name(cut_worker_t* worker, const cut_test_t* test, struct tm* stamp)
+{
+  size_t i = 0;
+
+  assert(worker);
+  assert(test);
+  assert(stamp);
+
+  cut_printf(worker, "%02u:%02u:%02u %s%s ", stamp->tm_hour, stamp->tm_min, stamp->tm_sec, CUT_TEST_NAME(test));
+  for (i = cut_test_suite(test)->prefix_length + strlen(g_cut->test_name[test - g_cut->test]); i < 50; i++) cut_printf(worker, ".");
+  cut_printf(worker, " ");
+  worker->test_name_hanging = 1;
+  if (!worker->buffered) fflush(stdout);
+}   /* cut_print_test_name() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Prints @a result and the elapsed @a usec, as minutes, seconds and
+ * microseconds, after a test's name.
+ */
+static void cut_print_result_time(cut_worker_t* worker, cut_result_t result, usec_t usec)
+{
+  cut_printf(worker, "%-5s %02u:%02u.%06u", cut_result_name[result],
+             (int) (usec / (60 * 1000000)), (int) ((usec / 1000000) % 60), (int) (usec % 1000000));
+}   /* cut_print_result_time() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the data buffer to be used by @a worker when running a test in
+ * @a suite, or NULL if one could not be allocated. The buffer is zeroed,
+ * except in snapshot mode where it is about to be overwritten.
+ */
+static void* cut_worker_data(cut_worker_t* worker, cut_suite_t* suite)
+{
+  assert(NULL != worker);
+  assert(NULL != suite);
+
+  if ((NULL == suite->data) || !worker->buffered)
+  {
+    if (suite->data && !suite->snapshot)
+    {
+      memset(suite->data, 0, suite->size);
+    }
+
+    return suite->data;
+  }
+
+  if (worker->data_size < suite->size)
+  {
+    void* data = realloc(worker->data, suite->size);
+
+    if (NULL == data)
+    {
+      return NULL;
+    }
+
+    worker->data = data;
+    worker->data_size = suite->size;
+  }
+
+  if (!suite->snapshot)
+  {
+    memset(worker->data, 0, suite->size);
+  }
+
+  return worker->data;
+}   /* cut_worker_data() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the time limit for @a test in microseconds - its own, its suite's
+ * or cut_timeout_msec - or 0 if it has none.
+ */
+static usec_t cut_test_timeout(const cut_test_t* test)
+{
+  unsigned msec = test->timeout_msec;
+
+  if (0 == msec)
+  {
+    msec = cut_test_suite(test)->timeout_msec;
+  }
+
+  if ((0 == msec) && (cut_timeout_msec > 0))
+  {
+    msec = (unsigned) cut_timeout_msec;
+  }
+
+  return (usec_t) msec * 1000;
+}   /* cut_test_timeout() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Tells the watchdog that @a worker started running @a test at
+ * @a start_time, or with @a test NULL, that it is no longer running one.
+ */
+static void cut_watch(cut_worker_t* worker, cut_test_t* test, usec_t start_time, const struct tm* stamp)
+{
+  usec_t timeout = (NULL != test) ? cut_test_timeout(test) : 0;
+
+  cut_mutex_lock(&g_cut->lock);
+  worker->watch_test = (timeout > 0) ? test : NULL;
+  worker->watch_start = start_time;
+  worker->watch_deadline = start_time + timeout;
+
+  if (NULL != stamp)
+  {
+    worker->watch_stamp = *stamp;
+  }
+
+  cut_mutex_unlock(&g_cut->lock);
+}   /* cut_watch() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs the once-per-suite setup for @a suite on @a worker if it has not run
+ * yet, followed in snapshot mode by the init() that fills the snapshot. An
+ * isolated test's process only checks the result of the setup done
+ * by its parent (or forkserver).
+ *
+ * The setup runs without the suite_lock held, so that workers busy with
+ * other suites are not held up by it; workers that reach the same suite
+ * meanwhile wait for it to finish.
+ *
+ * @return CUT_RESULT_PASS if the suite's tests may run, CUT_RESULT_ERROR if
+ * its setup failed.
+ */
+static cut_result_t cut_suite_enter(cut_worker_t* worker, cut_suite_t* suite)
+{
+  cut_result_t result = CUT_RESULT_PASS;
+
+  if (!CUT_SUITE_HAS_ONCE(suite))
+  {
+    return CUT_RESULT_PASS;
+  }
+
+  if (worker->report)
+  {
+    return (CUT_SUITE_FAILED == suite->state) ? CUT_RESULT_ERROR : CUT_RESULT_PASS;
+  }
+
+  cut_mutex_lock(&g_cut->suite_lock);
+
+  while (CUT_SUITE_BUSY == suite->state)
+  {
+    cut_cond_wait(&suite->changed, &g_cut->suite_lock);
+  }
+
+  if (CUT_SUITE_IDLE == suite->state)
+  {
+    cut_suite_t* active_suite = worker->active_suite;
+
+    suite->state = CUT_SUITE_BUSY;
+    cut_mutex_unlock(&g_cut->suite_lock);
+    worker->active_suite = suite;
+
+    if (NULL != suite->shared)
+    {
+      memset(suite->shared, 0, suite->shared_size);
+    }
+
+    if (NULL == suite->setup)
+    {
+      result = CUT_RESULT_PASS;
+    }
+    else if (NULL != g_cut_wrap_init)
+    {
+      result = g_cut_wrap_init(suite->setup, suite->shared, g_cut_wrap_cookie);
+    }
+    else
+    {
+      result = suite->setup(suite->shared);
+    }
+
+    if ((CUT_RESULT_PASS == result) && (NULL != suite->snapshot))
+    {
+      memset(suite->snapshot, 0, suite->size);
+
+      if (NULL == suite->init)
+      {
+        /* Nothing to do. */
+      }
+      else if (NULL != g_cut_wrap_init)
+      {
+        result = g_cut_wrap_init(suite->init, suite->snapshot, g_cut_wrap_cookie);
+      }
+      else
+      {
+        result = suite->init(suite->snapshot);
+      }
+    }
+
+    worker->active_suite = active_suite;
+
+    if ((CUT_RESULT_PASS != result) && (cut_print_case_flags & CUT_FLAG_ERROR))
+    {
+      if (worker->test_name_hanging)
+      {
+        cut_printf(worker, "\n");
+        worker->test_name_hanging = 0;
+      }
+
+      cut_printf(worker, "%s: %-5s suite setup failed; its tests are not run\n",
+                 suite->name, cut_result_name[CUT_RESULT_ERROR]);
+    }
+
+    cut_mutex_lock(&g_cut->suite_lock);
+    suite->state = (CUT_RESULT_PASS == result) ? CUT_SUITE_READY : CUT_SUITE_FAILED;
+    cut_cond_broadcast(&suite->changed);
+  }
+
+  result = (CUT_SUITE_READY == suite->state) ? CUT_RESULT_PASS : CUT_RESULT_ERROR;
+  cut_mutex_unlock(&g_cut->suite_lock);
+  return result;
+}   /* cut_suite_enter() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Notes that one of the tests in @a suite has finished, running the suite's
+ * teardown on @a worker after the last of them, preceded in snapshot mode by
+ * the exit() of the snapshot. These run even if the setup failed, just as a
+ * test's exit function runs after its init, and like the setup they run
+ * without the suite_lock held.
+ */
+static void cut_suite_leave(cut_worker_t* worker, cut_suite_t* suite)
+{
+  if (!CUT_SUITE_HAS_ONCE(suite) || worker->report)
+  {
+    return;
+  }
+
+  cut_mutex_lock(&g_cut->suite_lock);
+
+  if ((suite->pending > 0) && (0 == --suite->pending) && (CUT_SUITE_IDLE != suite->state))
+  {
+    cut_suite_t* active_suite = worker->active_suite;
+
+    suite->state = CUT_SUITE_BUSY;
+    cut_mutex_unlock(&g_cut->suite_lock);
+    worker->active_suite = suite;
+
+    if ((NULL != suite->snapshot) && (NULL != suite->exit))
+    {
+      if (NULL != g_cut_wrap_exit)
+      {
+        g_cut_wrap_exit(suite->exit, suite->snapshot, g_cut_wrap_cookie);
+      }
+      else
+      {
+        suite->exit(suite->snapshot);
+      }
+    }
+
+    if (NULL == suite->teardown)
+    {
+      /* Nothing to do. */
+    }
+    else if (NULL != g_cut_wrap_exit)
+    {
+      g_cut_wrap_exit(suite->teardown, suite->shared, g_cut_wrap_cookie);
+    }
+    else
+    {
+      suite->teardown(suite->shared);
+    }
+
+    worker->active_suite = active_suite;
+    cut_mutex_lock(&g_cut->suite_lock);
+    suite->state = CUT_SUITE_IDLE;
+    cut_cond_broadcast(&suite->changed);
+  }
+
+  cut_mutex_unlock(&g_cut->suite_lock);
+}   /* cut_suite_leave() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Counts the tests of each suite that will run, so that cut_suite_leave()
+ * knows when the last one has finished, and readies the condition variables
+ * of the suites with once-per-suite work for the run.
+ */
+static void cut_count_suite_tests(void)
+{
+  cut_suite_t* suite = NULL;
+  size_t i = 0;
+
+  for (suite = g_cut->suite; suite < &g_cut->suite[g_cut->suite_count]; suite++)
+  {
+    suite->state = CUT_SUITE_IDLE;
+    suite->pending = 0;
+
+    if (CUT_SUITE_HAS_ONCE(suite))
+    {
+      cut_cond_init(&suite->changed);
+    }
+  }
+
+  for (i = 0; i < g_cut->run_count; i++)
+  {
+    if (!(g_cut->run[i]->flags & CUT_TEST_FLAG_EXCLUDE))
+    {
+      cut_test_suite(g_cut->run[i])->pending++;
+    }
+  }
+}   /* cut_count_suite_tests() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases what cut_count_suite_tests() set up for the run.
+ */
+static void cut_release_suites(void)
+{
+  cut_suite_t* suite = NULL;
+
+  for (suite = g_cut->suite; suite < &g_cut->suite[g_cut->suite_count]; suite++)
+  {
+    if (CUT_SUITE_HAS_ONCE(suite))
+    {
+      cut_cond_destroy(&suite->changed);
+    }
+  }
+}   /* cut_release_suites() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Prints the exact elapsed @a nsec of a test, and the CPU time, context
+ * switches and page faults it used between @a start and @a end, to follow
+ * its elapsed time (rounded to microseconds) on its result line.
+ */
+static void cut_print_resources_used(cut_worker_t* worker, uint64_t nsec, const cut_resources_t* start, const cut_resources_t* end)
+{
+  uint64_t user_usec = (end->user_nsec - start->user_nsec) / 1000;
+  uint64_t sys_usec = (end->sys_nsec - start->sys_nsec) / 1000;
+
+  cut_printf(worker, " wall %llu ns", (unsigned long long) nsec);
+  cut_printf(worker, " user %u.%06u sys %u.%06u csw %llu/%llu flt %llu/%llu",
+             (unsigned) (user_usec / 1000000), (unsigned) (user_usec % 1000000),
+             (unsigned) (sys_usec / 1000000), (unsigned) (sys_usec % 1000000),
+             (unsigned long long) (end->voluntary_switches - start->voluntary_switches),
+             (unsigned long long) (end->involuntary_switches - start->involuntary_switches),
+             (unsigned long long) (end->minor_faults - start->minor_faults),
+             (unsigned long long) (end->major_faults - start->major_faults));
+}   /* cut_print_resources_used() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Prints the events counted in the test phase of @a worker's test, or per
+ * iteration of its benchmark, to follow its result line, and adds the
+ * counts of each phase to the worker's totals.
+ */
+static void cut_print_perf_counts(cut_worker_t* worker)
+{
+  int phase = 0;
+  int i = 0;
+
+  cut_printf(worker, "%s", worker->bench_perf_have ? " per op:" : "");
+
+  for (i = 0; i < CUT_PERF_COUNT; i++)
+  {
+    if (worker->perf_fd[i] < 0)
+    {
+      continue;
+    }
+
+    if (worker->bench_perf_have)
+    {
+      cut_printf(worker, " %s %.1f", cut_perf_name[i], worker->bench_perf[i]);
+    }
+    else
+    {
+      cut_printf(worker, " %s %llu", cut_perf_name[i], (unsigned long long) worker->perf_test[CUT_PERF_TEST][i]);
+    }
+
+    for (phase = 0; phase < CUT_PERF_PHASES; phase++)
+    {
+      worker->perf_total[phase][i] += worker->perf_test[phase][i];
+    }
+
+    worker->perf_have |= 1u << i;
+  }
+}   /* cut_print_perf_counts() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * qsort() comparison of two doubles.
+ */
+static int cut_compare_double(const void* a, const void* b)
+{
+  double x = *(const double*) a;
+  double y = *(const double*) b;
+
+  return (x < y) ? -1 : (x > y) ? 1 : 0;
+}   /* cut_compare_double() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the median of the @a count values at @a value, which are sorted.
+ */
+static double cut_median(const double* value, int count)
+{
+  return (count & 1) ? value[count / 2] : (value[count / 2 - 1] + value[count / 2]) / 2;
+}   /* cut_median() */
+
+/**
+ * Timed runs of a benchmark in nanoseconds per iteration, sorted: those
+ * read from cut_benchmark_baseline and those measured in this run.
+ */
+typedef struct cut_bench_runs_s
+{
+  double* base;
+  int base_count;
+  double* nsec;
+  int count;
+} cut_bench_runs_t;
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Keeps the @a count runs at @a nsec, allocated with malloc(), as the
+ * measurement of benchmark @a test, to be saved after the run.
+ */
+static void cut_bench_keep(const cut_test_t* test, double* nsec, int count)
+{
+  cut_bench_runs_t* runs = &g_cut->bench[test - g_cut->test];
+
+  free(runs->nsec);
+  runs->nsec = nsec;
+  runs->count = count;
+}   /* cut_bench_keep() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * One-sided Mann-Whitney U test of whether the @a count values at @a x
+ * tend to be greater than the @a base_count values at @a base multiplied by
+ * @a scale. Ties count half.
+ *
+ * The exact distribution of U, for values without ties, is given by the
+ * coefficients of the Gaussian binomial coefficient [n + m choose n]; each
+ * step below turns [m + i - 1 choose i - 1] into [m + i choose i]. Their
+ * sum, n + m choose n, overflows a double for large n and m, so a side with
+ * more than CUT_BENCHMARK_MAX_TEST_RUNS values is thinned out to that many,
+ * evenly spaced.
+ *
+ * @return the p-value, the chance of a U at least this large were @a x no
+ * greater, or 1 if out of memory.
+ */
+static double cut_mann_whitney(const double* x, int count, const double* base, int base_count, double scale)
+{
+  int n = (count > CUT_BENCHMARK_MAX_TEST_RUNS) ? CUT_BENCHMARK_MAX_TEST_RUNS : count;
+  int m = (base_count > CUT_BENCHMARK_MAX_TEST_RUNS) ? CUT_BENCHMARK_MAX_TEST_RUNS : base_count;
+  size_t max_u = (size_t) n * m;
+  double* ways = (double*) calloc(max_u + 1, sizeof(double));
+  double total = 0;
+  double tail = 0;
+  double u = 0;
+  size_t k = 0;
+  size_t v = 0;
+  int i = 0;
+  int j = 0;
+
+  if (NULL == ways)
+  {
+    return 1;
+  }
+
+  for (i = 0; i < n; i++)
+  {
+    double value = x[(size_t) i * count / n];
+
+    for (j = 0; j < m; j++)
+    {
+      double limit = base[(size_t) j * base_count / m] * scale;
+
+      u += (value > limit) ? 1 : (value == limit) ? 0.5 : 0;
+    }
+  }
+
+  ways[0] = 1;
+
+  for (i = 1; i <= n; i++)
+  {
+    k = (size_t) m + i;
+
+    for (v = max_u; v >= k; v--)
+    {
+      ways[v] -= ways[v - k];
+    }
+
+    for (v = i; v <= max_u; v++)
+    {
+      ways[v] += ways[v - i];
+    }
+  }
+
+  for (v = 0; v <= max_u; v++)
+  {
+    total += ways[v];
+    tail += (v + 0.25 >= u) ? ways[v] : 0;
+  }
+
+  free(ways);
+  return tail / total;
+}   /* cut_mann_whitney() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs @a func on @a data with a count of iterations that grows from 1
+ * until a run takes at least cut_benchmark_msec; these runs also warm it up.
+ *
+ * @return the first result other than CUT_RESULT_PASS, or CUT_RESULT_PASS
+ * with the count in @a iterations.
+ */
+static cut_result_t cut_bench_calibrate(cut_benchmark_func_t func, void* data, size_t* iterations)
+{
+  uint64_t target_nsec = (uint64_t) cut_benchmark_msec * 1000000;
+  cut_result_t result = CUT_RESULT_PASS;
+
+  *iterations = 1;
+
+  /*
+   * Grow the count until a run takes long enough, aiming a little past the
+   * target so that the last run is unlikely to fall just short of it.
+   */
+  for (;;)
+  {
+    uint64_t start = nsec_time();
+    uint64_t nsec = 0;
+    double next = 0;
+
+    if (CUT_RESULT_PASS != (result = func(data, *iterations)))
+    {
+      return result;
+    }
+
+    nsec = nsec_time() - start;
+
+    if ((nsec >= target_nsec) || (*iterations >= CUT_BENCHMARK_MAX_ITERATIONS))
+    {
+      return CUT_RESULT_PASS;
+    }
+
+    next = (nsec > 0) ? (1.2 * *iterations * target_nsec / nsec) : (double) *iterations * CUT_BENCHMARK_MAX_GROWTH;
+    next = (next > (double) *iterations * CUT_BENCHMARK_MAX_GROWTH) ? (double) *iterations * CUT_BENCHMARK_MAX_GROWTH : next;
+    next = (next > CUT_BENCHMARK_MAX_ITERATIONS) ? CUT_BENCHMARK_MAX_ITERATIONS : next;
+    *iterations = (next > (double) *iterations) ? (size_t) next : *iterations + 1;
+  }
+}   /* cut_bench_calibrate() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Leaves the statistics of the @a runs timed runs of @a iterations each at
+ * @a nsec_per_op in @a worker, comparing them with any baseline.
+ * @a nsec_per_op has room for 2 * @a runs values and is taken over: it is
+ * kept in the worker if the runs are to be saved, and freed otherwise.
+ *
+ * @return CUT_RESULT_FAIL if the runs are significantly slower than the
+ * baseline, CUT_RESULT_ERROR if they could not be compared with it (as when
+ * the baseline holds values that are not numbers), otherwise
+ * CUT_RESULT_PASS.
+ */
+static cut_result_t cut_bench_summarize(cut_worker_t* worker, double* nsec_per_op, int runs, size_t iterations)
+{
+  double* deviation = &nsec_per_op[runs];
+  const cut_bench_runs_t* baseline = NULL;
+  cut_result_t result = CUT_RESULT_PASS;
+  int i = 0;
+
+  qsort(nsec_per_op, runs, sizeof(double), cut_compare_double);
+  worker->bench_median = cut_median(nsec_per_op, runs);
+  worker->bench_min = nsec_per_op[0];
+
+  for (i = 0; i < runs; i++)
+  {
+    deviation[i] = nsec_per_op[i] - worker->bench_median;
+    deviation[i] = (deviation[i] < 0) ? -deviation[i] : deviation[i];
+  }
+
+  qsort(deviation, runs, sizeof(double), cut_compare_double);
+  worker->bench_mad = cut_median(deviation, runs);
+  worker->bench_iterations = iterations;
+  worker->bench_runs = runs;
+
+  baseline = (NULL != g_cut->bench) ? &g_cut->bench[worker->active_test - g_cut->test] : NULL;
+
+  if ((NULL != baseline) && (baseline->base_count > 0))
+  {
+    worker->bench_compared = 1;
+    worker->bench_change = worker->bench_median / cut_median(baseline->base, baseline->base_count) - 1;
+    worker->bench_p = cut_mann_whitney(nsec_per_op, runs, baseline->base, baseline->base_count,
+                                       1 + cut_benchmark_threshold / 100.0);
+
+    /*
+     * A p-value or change that is not a number (the comparisons below fail
+     * for NaN) means the comparison did not work, which must not pass.
+     */
+    if (!((worker->bench_p >= 0) && (worker->bench_p <= 1)) || (worker->bench_change != worker->bench_change))
+    {
+      result = CUT_RESULT_ERROR;
+    }
+    else if (worker->bench_p < CUT_BENCHMARK_ALPHA)
+    {
+      result = CUT_RESULT_FAIL;
+    }
+  }
+
+  if (NULL != g_cut->bench)
+  {
+    worker->bench_nsec = nsec_per_op;
+  }
+  else
+  {
+    free(nsec_per_op);
+  }
+
+  return result;
+}   /* cut_bench_summarize() */
+
+/**
+ * Index of this thread in the run of a scaling benchmark, how many threads
+ * it is run on, and the iterations each of them runs.
+ */
+static CUT_THREAD_LOCAL int g_cut_bench_thread = 0;
+static CUT_THREAD_LOCAL int g_cut_bench_threads = 1;
+static CUT_THREAD_LOCAL size_t g_cut_bench_iterations = 0;
+
+/* ------------------------------------------------------------------------- */
+int cut_benchmark_thread(void)
+{
+  return g_cut_bench_thread;
+}   /* cut_benchmark_thread() */
+
+/* ------------------------------------------------------------------------- */
+int cut_benchmark_thread_count(void)
+{
+  return g_cut_bench_threads;
+}   /* cut_benchmark_thread_count() */
+
+/**
+ * Shared state of a scaling benchmark measured at one thread count. Each
+ * run begins when all @a threads have reached @a start and ends when all
+ * have reached @a finish; @a stop is set before the last @a start.
+ */
+typedef struct cut_scaling_s
+{
+  cut_barrier_t start;
+  cut_barrier_t finish;
+  cut_suite_t* suite;
+  cut_test_t* test;
+  size_t iterations;
+  int threads;
+  int stop;
+} cut_scaling_t;
+
+/**
+ * A thread of a scaling benchmark other than the test's own, with its data
+ * and the worker that takes its assertions and output until they are
+ * passed on to the test's worker.
+ */
+typedef struct cut_scaling_thread_s
+{
+  cut_thread_t thread;
+  cut_worker_t worker;
+  cut_scaling_t* scaling;
+  int index;
+  void* data;
+  cut_result_t result;
+} cut_scaling_thread_t;
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Calls @a func on @a data through the test wrapper, if there is one.
+ */
+static cut_result_t cut_call_test(cut_test_func_t func, void* data)
+{
+  if (NULL != g_cut_wrap_test)
+  {
+    return g_cut_wrap_test(func, data, g_cut_wrap_cookie);
+  }
+
+  return func(data);
+}   /* cut_call_test() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs one run of the active scaling benchmark on this thread, on @a data.
+ */
+static cut_result_t cut_run_scaling_step(void* data)
+{
+  cut_benchmark_func_t func = g_cut_worker->active_test->benchmark_func;
+  return func(data, g_cut_bench_iterations);
+}   /* cut_run_scaling_step() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Body of a scaling benchmark's thread @a arg (a cut_scaling_thread_t): it
+ * prepares its data as a test's would be, then runs the benchmark once
+ * between each pair of barriers until told to stop.
+ */
+static void cut_scaling_thread(void* arg)
+{
+  cut_scaling_thread_t* self = (cut_scaling_thread_t*) arg;
+  cut_scaling_t* scaling = self->scaling;
+  cut_suite_t* suite = scaling->suite;
+
+  g_cut_worker = &self->worker;
+  g_cut_bench_thread = self->index;
+  g_cut_bench_threads = scaling->threads;
+  g_cut_bench_iterations = scaling->iterations;
+  cut_fast_passes = 0;
+
+  if (suite->snapshot)
+  {
+    memcpy(self->data, suite->snapshot, suite->size);
+  }
+  else if (suite->init)
+  {
+    if (NULL != g_cut_wrap_init)
+    {
+      self->result = g_cut_wrap_init(suite->init, self->data, g_cut_wrap_cookie);
+    }
+    else
+    {
+      self->result = suite->init(self->data);
+    }
+  }
+
+  cut_collect_fast_passes(&self->worker);
+  self->worker.active_test = scaling->test;
+
+  for (;;)
+  {
+    cut_barrier_wait(&scaling->start);
+
+    if (scaling->stop)
+    {
+      break;
+    }
+
+    if (CUT_RESULT_PASS == self->result)
+    {
+      self->result = cut_call_test(cut_run_scaling_step, self->data);
+    }
+
+    cut_barrier_wait(&scaling->finish);
+  }
+
+  cut_collect_fast_passes(&self->worker);
+  self->worker.active_test = NULL;
+
+  if (suite->exit && !suite->snapshot)
+  {
+    if (NULL != g_cut_wrap_exit)
+    {
+      g_cut_wrap_exit(suite->exit, self->data, g_cut_wrap_cookie);
+    }
+    else
+    {
+      suite->exit(self->data);
+    }
+
+    cut_collect_fast_passes(&self->worker);
+  }
+}   /* cut_scaling_thread() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Passes the assertions, output and assertion sites of a scaling
+ * benchmark's thread, in @a from, on to the test's @a worker.
+ */
+static void cut_scaling_merge(cut_worker_t* worker, cut_worker_t* from)
+{
+  int r = 0;
+
+  for (r = CUT_RESULT_FIRST; r <= CUT_RESULT_LAST; r++)
+  {
+    worker->assertions[r] += from->assertions[r];
+  }
+
+  if (from->out_len > 0)
+  {
+    if (worker->test_name_hanging)
+    {
+      cut_printf(worker, "\n");
+      worker->test_name_hanging = 0;
+    }
+
+    cut_printf(worker, "%.*s", (int) from->out_len, from->out);
+  }
+
+  free(from->out);
+  from->out = NULL;
+  cut_site_merge(&worker->sites, &from->sites);
+}   /* cut_scaling_merge() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Times @a runs runs of the worker's active scaling benchmark on @a threads
+ * threads, each running @a iterations, after one untimed run. The test's
+ * thread is the first of them and uses @a data. The wall time of each run
+ * per operation is left at @a nsec_per_op.
+ *
+ * @return the first result other than CUT_RESULT_PASS from any thread, or
+ * CUT_RESULT_PASS.
+ */
+static cut_result_t cut_run_scaling_count(cut_worker_t* worker, void* data, int threads, size_t iterations,
+                                          double* nsec_per_op, int runs)
+{
+  cut_scaling_t scaling;
+  cut_scaling_thread_t* helper = NULL;
+  cut_result_t result = CUT_RESULT_PASS;
+  int started = 0;
+  int round = 0;
+  int i = 0;
+
+  memset(&scaling, 0, sizeof(scaling));
+  scaling.suite = worker->active_suite;
+  scaling.test = worker->active_test;
+  scaling.iterations = iterations;
+  scaling.threads = threads;
+
+  helper = (cut_scaling_thread_t*) calloc(threads, sizeof(cut_scaling_thread_t));
+
+  if (NULL == helper)
+  {
+    return CUT_RESULT_ERROR;
+  }
+
+  for (i = 1; i < threads; i++)
+  {
+    helper[i].data = (NULL != scaling.suite->data) ? calloc(1, scaling.suite->size) : NULL;
+
+    if ((NULL != scaling.suite->data) && (NULL == helper[i].data))
+    {
+      result = CUT_RESULT_ERROR;
+    }
+  }
+
+  cut_barrier_init(&scaling.start, threads);
+  cut_barrier_init(&scaling.finish, threads);
+
+  for (started = 1; (started < threads) && (CUT_RESULT_PASS == result); started++)
+  {
+    cut_scaling_thread_t* self = &helper[started];
+
+    self->worker.active_suite = worker->active_suite;
+    self->worker.buffered = 1;
+    self->worker.site_time = worker->site_time;
+    self->scaling = &scaling;
+    self->index = started;
+    self->result = CUT_RESULT_PASS;
+
+    if (CUT_RESULT_PASS != cut_thread_start(&self->thread, cut_scaling_thread, self))
+    {
+      result = CUT_RESULT_ERROR;
+      break;
+    }
+  }
+
+  /*
+   * If not all of the threads could be started, those that were still
+   * wait for this one to tell them to stop.
+   */
+  if (started < threads)
+  {
+    cut_mutex_lock(&scaling.start.lock);
+    scaling.start.count = started;
+    cut_mutex_unlock(&scaling.start.lock);
+  }
+
+  g_cut_bench_threads = threads;
+  g_cut_bench_iterations = iterations;
+
+  for (round = 0; (round <= runs) && (CUT_RESULT_PASS == result); round++)
+  {
+    uint64_t start = 0;
+
+    cut_barrier_wait(&scaling.start);
+    start = nsec_time();
+    result = cut_call_test(cut_run_scaling_step, data);
+    cut_barrier_wait(&scaling.finish);
+
+    if (round > 0)
+    {
+      nsec_per_op[round - 1] = (double) (nsec_time() - start) / ((double) threads * iterations);
+    }
+
+    for (i = 1; (i < threads) && (CUT_RESULT_PASS == result); i++)
+    {
+      result = helper[i].result;
+    }
+  }
+
+  scaling.stop = 1;
+  cut_barrier_wait(&scaling.start);
+
+  for (i = 1; i < started; i++)
+  {
+    cut_thread_join(&helper[i].thread);
+    cut_scaling_merge(worker, &helper[i].worker);
+  }
+
+  for (i = 1; i < threads; i++)
+  {
+    free(helper[i].data);
+  }
+
+  g_cut_bench_threads = 1;
+  g_cut_bench_iterations = 0;
+  cut_barrier_destroy(&scaling.start);
+  cut_barrier_destroy(&scaling.finish);
+  free(helper);
+  return result;
+}   /* cut_run_scaling_count() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Measures the worker's active scaling benchmark, with @a iterations per
+ * run on each thread, at each of the thread counts of
+ * cut_benchmark_threads, the test's thread using @a data. The operations
+ * per second at each count are left in the worker, and the statistics of
+ * the last count's runs as for any benchmark.
+ *
+ * @return the first result other than CUT_RESULT_PASS, or CUT_RESULT_PASS.
+ */
+static cut_result_t cut_run_scaling(cut_worker_t* worker, void* data, size_t iterations, int runs)
+{
+  int counts[CUT_BENCHMARK_MAX_COUNTS];
+  int count = cut_parse_thread_counts(cut_benchmark_threads, counts);
+  cut_result_t result = CUT_RESULT_PASS;
+  int c = 0;
+
+  for (c = 0; (c < count) && (CUT_RESULT_PASS == result); c++)
+  {
+    double* nsec_per_op = (double*) malloc(2 * runs * sizeof(double));
+
+    if (NULL == nsec_per_op)
+    {
+      return CUT_RESULT_ERROR;
+    }
+
+    result = cut_run_scaling_count(worker, data, counts[c], iterations, nsec_per_op, runs);
+
+    if (CUT_RESULT_PASS == result)
+    {
+      qsort(nsec_per_op, runs, sizeof(double), cut_compare_double);
+      worker->bench_threads[c] = counts[c];
+      worker->bench_ops[c] = 1e9 / cut_median(nsec_per_op, runs);
+      worker->bench_scaling = c + 1;
+    }
+
+    if ((CUT_RESULT_PASS == result) && (c == count - 1))
+    {
+      result = cut_bench_summarize(worker, nsec_per_op, runs, iterations);
+    }
+    else
+    {
+      free(nsec_per_op);
+    }
+  }
+
+  return result;
+}   /* cut_run_scaling() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs the worker's active test, a benchmark, on @a data. It is called in
+ * place of a test function, so that any test wrapper is kept.
+ *
+ * When benchmarks are measured, the statistics are left in the worker for
+ * cut_run_test() to print.
+ *
+ * @return the first result other than CUT_RESULT_PASS from the benchmark,
+ * or CUT_RESULT_PASS.
+ */
+static cut_result_t cut_run_benchmark(void* data)
+{
+  cut_worker_t* worker = g_cut_worker;
+  cut_benchmark_func_t func = worker->active_test->benchmark_func;
+  int runs = (cut_benchmark_runs > 0) ? cut_benchmark_runs : 1;
+  size_t iterations = 1;
+  double* nsec_per_op = NULL;
+  uint64_t start_count[CUT_PERF_COUNT];
+  uint64_t count[CUT_PERF_COUNT];
+  cut_result_t result = CUT_RESULT_PASS;
+  int i = 0;
+
+  if (!cut_benchmark)
+  {
+    return func(data, 1);
+  }
+
+  if (CUT_RESULT_PASS != (result = cut_bench_calibrate(func, data, &iterations)))
+  {
+    return result;
+  }
+
+  if (worker->active_test->flags & CUT_TEST_FLAG_SCALING)
+  {
+    return cut_run_scaling(worker, data, iterations, runs);
+  }
+
+  nsec_per_op = (double*) malloc(2 * runs * sizeof(double));
+
+  if (NULL == nsec_per_op)
+  {
+    return CUT_RESULT_ERROR;
+  }
+
+  if (cut_perf_counters && (worker->perf_state > 0))
+  {
+    cut_perf_read(worker, start_count);
+  }
+
+  for (i = 0; (i < runs) && (CUT_RESULT_PASS == result); i++)
+  {
+    uint64_t start = nsec_time();
+
+    result = func(data, iterations);
+    nsec_per_op[i] = (double) (nsec_time() - start) / iterations;
+  }
+
+  if (cut_perf_counters && (worker->perf_state > 0))
+  {
+    cut_perf_read(worker, count);
+
+    for (i = 0; i < CUT_PERF_COUNT; i++)
+    {
+      worker->bench_perf[i] = (double) (count[i] - start_count[i]) / ((double) runs * iterations);
+    }
+
+    worker->bench_perf_have = 1;
+  }
+
+  if (CUT_RESULT_PASS != result)
+  {
+    free(nsec_per_op);
+    return result;
+  }
+
+  return cut_bench_summarize(worker, nsec_per_op, runs, iterations);
+}   /* cut_run_benchmark() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs a single @a test on @a worker - init, test and exit - and prints its
+ * result line. The result is also counted in the worker's totals.
+ *
+ * @return the result of the test.
+ */
+static cut_result_t cut_run_test(cut_worker_t* worker, cut_test_t* test)
+{
+  cut_suite_t* suite = NULL;
+  void*        data = NULL;
+  usec_t       start_time = 0;
+  uint64_t     start_nsec = 0;
+  uint64_t     nsec = 0;
+  uint64_t     usec = 0;
+  cut_resources_t start_resources;
+  cut_resources_t resources;
+  time_t       stamp_time;
+  struct tm    stamp;
+  cut_result_t result = CUT_RESULT_PASS;
+  int          exclude_test = 0;
+  int          entered = 0;
+  int          i = 0;
+
+  assert(worker);
+  assert(test);
+
+  suite = cut_test_suite(test);
+  worker->active_suite = suite;
+  worker->bench_runs = 0;
+  worker->bench_compared = 0;
+  worker->bench_perf_have = 0;
+  worker->bench_scaling = 0;
+  worker->allocs_tracked = 0;
+  memset(worker->perf_test, 0, sizeof(worker->perf_test));
+  exclude_test = (test->flags & CUT_TEST_FLAG_EXCLUDE) != 0;
+  data = cut_worker_data(worker, suite);
+
+  stamp_time = time(NULL);
+#if defined(_WIN32)
+  localtime_s(&stamp, &stamp_time);
+#elif defined(MINGW) && MINGW
+  stamp = *localtime(&stamp_time);
+#else
+  localtime_r(&stamp_time, &stamp);
+#endif
+  cut_print_test_name(worker, test, &stamp);
+
+  if (cut_print_resources)
+  {
+    cut_get_resources(&start_resources);
+  }
+
+  start_nsec = nsec_time();
+  start_time = start_nsec / 1000;
+
+  if (cut_perf_counters && !exclude_test)
+  {
+    cut_perf_open(worker);
+    cut_perf_phase(worker, -1);
+  }
+
+  if (g_cut->watching && !exclude_test)
+  {
+    cut_watch(worker, test, start_time, &stamp);
+  }
+
+  if ((NULL != suite->data) && (NULL == data))
+  {
+    result = CUT_RESULT_ERROR;
+  }
+  else if (!exclude_test)
+  {
+    cut_fast_passes = 0;
+    entered = (CUT_RESULT_PASS == (result = cut_suite_enter(worker, suite)));
+
+    if (entered && cut_track_allocations)
+    {
+      cut_alloc_start(worker);
+    }
+
+    if (entered && suite->snapshot)
+    {
+      memcpy(data, suite->snapshot, suite->size);
+    }
+    else if (entered && suite->init)
+    {
+      if (NULL != g_cut_wrap_init)
+      {
+        result = g_cut_wrap_init(suite->init, data, g_cut_wrap_cookie);
+      }
+      else
+      {
+        result = suite->init(data);
+      }
+    }
+
+    cut_collect_fast_passes(worker);
+    cut_perf_phase(worker, CUT_PERF_INIT);
+  }
+
+  /*
+   * Only run test if init() succeeded.
+   */
+  if (CUT_RESULT_PASS == result)
+  {
+    if ((NULL == test->func) || exclude_test)
+    {
+      result = CUT_RESULT_SKIP;
+    }
+    else
+    {
+      cut_test_func_t func = test->func;
+
+      worker->active_test = test;
+      worker->site_time = cut_profile_assertions ? usec_time() : 0;
+
+      if (NULL != g_cut_wrap_test)
+      {
+        result = g_cut_wrap_test(func, data, g_cut_wrap_cookie);
+      }
+      else
+      {
+        result = func(data);
+      }
+
+      cut_collect_fast_passes(worker);
+      cut_perf_phase(worker, CUT_PERF_TEST);
+      worker->active_test = NULL;
+    }
+  }
+
+  if ((result < CUT_RESULT_FIRST) ||
+      (result > CUT_RESULT_LAST))
+  {
+    result = CUT_RESULT_ERROR;
+  }
+
+  worker->tests[result]++;
+
+  /*
+   * Always run the finalization function if it exists.
+   */
+  if (suite->exit && entered && !suite->snapshot)
+  {
+    if (NULL != g_cut_wrap_exit)
+    {
+      g_cut_wrap_exit(suite->exit, data, g_cut_wrap_cookie);
+    }
+    else
+    {
+      suite->exit(data);
+    }
+
+    cut_collect_fast_passes(worker);
+  }
+
+  g_cut_allocs = NULL;
+  g_cut_alloc_depth = 0;
+
+  if (!exclude_test)
+  {
+    cut_suite_leave(worker, suite);
+    cut_perf_phase(worker, CUT_PERF_EXIT);
+  }
+
+  if (g_cut->watching && !exclude_test)
+  {
+    cut_watch(worker, NULL, 0, NULL);
+  }
+
+  /*
+   * If the test name was removed due to an assertion being printed, put
+   * it back.
+   */
+  if (!worker->test_name_hanging)
+  {
+    cut_print_test_name(worker, test, &stamp);
+  }
+
+  nsec = nsec_time() - start_nsec;
+  usec = nsec / 1000;
+
+  /*
+   * A watchdog that stops the run reads the results of finished tests, so
+   * they are published under the lock.
+   */
+  if (g_cut->watching)
+  {
+    cut_mutex_lock(&g_cut->lock);
+  }
+
+  if (!exclude_test)
+  {
+    test->usec = usec;
+    test->result = result;
+    test->flags |= CUT_TEST_FLAG_TIMED | CUT_TEST_FLAG_RESULT;
+  }
+
+  if (g_cut->watching)
+  {
+    memcpy(worker->done_assertions, worker->assertions, sizeof(worker->assertions));
+    memcpy(worker->done_tests, worker->tests, sizeof(worker->tests));
+    cut_mutex_unlock(&g_cut->lock);
+  }
+
+  cut_print_result_time(worker, result, usec);
+
+  if (worker->bench_runs > 0)
+  {
+    cut_printf(worker, " %.2f ns/op (min %.2f, MAD %.2f, %d x %llu)", worker->bench_median, worker->bench_min,
+               worker->bench_mad, worker->bench_runs, (unsigned long long) worker->bench_iterations);
+  }
+
+  if (worker->bench_compared)
+  {
+    cut_printf(worker, " %+.1f%% vs baseline, p %.3f", 100 * worker->bench_change, worker->bench_p);
+  }
+
+  if (cut_perf_counters && !exclude_test && (worker->perf_state > 0))
+  {
+    cut_print_perf_counts(worker);
+  }
+
+  if (worker->allocs_tracked)
+  {
+    cut_printf(worker, " allocs %llu bytes %llu peak %llu leaks %llu (%llu bytes)",
+               (unsigned long long) worker->allocs.count, (unsigned long long) worker->allocs.bytes,
+               (unsigned long long) worker->allocs.peak_bytes, (unsigned long long) worker->allocs.live_count,
+               (unsigned long long) worker->allocs.live_bytes);
+  }
+
+  if (cut_print_resources)
+  {
+    cut_get_resources(&resources);
+    cut_print_resources_used(worker, nsec, &start_resources, &resources);
+  }
+
+  cut_printf(worker, "\n");
+
+  for (i = 0; i < worker->bench_scaling; i++)
+  {
+    cut_printf(worker, "    %4d threads %16.0f ops/s %6.1f%% efficiency\n", worker->bench_threads[i],
+               worker->bench_ops[i], 100 * (worker->bench_ops[i] / worker->bench_threads[i]) /
+               (worker->bench_ops[0] / worker->bench_threads[0]));
+  }
+
+  /*
+   * An isolated test's runs are saved by the parent.
+   */
+  if (NULL != worker->bench_nsec)
+  {
+    if (worker->report)
+    {
+      cut_write_frame(worker->report_fd, CUT_FRAME_BENCHMARK, worker->bench_nsec, worker->bench_runs * sizeof(double));
+      free(worker->bench_nsec);
+    }
+    else
+    {
+      cut_bench_keep(test, worker->bench_nsec, worker->bench_runs);
+    }
+
+    worker->bench_nsec = NULL;
+  }
+
+  worker->test_name_hanging = 0;
+  worker->active_suite = NULL;
+  cut_flush_worker(worker);
+  return result;
+}   /* cut_run_test() */
+
+static void cut_history_save(void);
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Reports the test on @a worker, which has run past its time limit, as an
+ * ERROR and exits. The hung test cannot be stopped safely, so there is no
+ * way to go on with the run. Called with the cut_t lock held, which keeps
+ * other workers from printing.
+ */
+static void cut_watchdog_expire(cut_worker_t* worker, usec_t now)
+{
+  cut_test_t* test = worker->watch_test;
+  usec_t usec = now - worker->watch_start;
+  cut_worker_t out;
+  int i = 0;
+  int r = 0;
+
+  memset(&out, 0, sizeof(out));
+
+  /*
+   * Unbuffered output may have left the test's name waiting for its
+   * result; otherwise the name starts a new line.
+   */
+  if (worker->buffered || !worker->test_name_hanging)
+  {
+    cut_print_test_name(&out, test, &worker->watch_stamp);
+  }
+
+  cut_print_result_time(&out, CUT_RESULT_ERROR, usec);
+  cut_printf(&out, " timed out\n");
+
+  /*
+   * Keep the history, so that the hung test is known to have failed. The
+   * other tests' results were published under the lock, which is held;
+   * tests still running on other workers are left as they were.
+   */
+  test->usec = usec;
+  test->result = CUT_RESULT_ERROR;
+  test->flags |= CUT_TEST_FLAG_TIMED | CUT_TEST_FLAG_RESULT;
+  cut_history_save();
+
+  if (g_cut->print_summary)
+  {
+    for (i = -1; i < g_cut->worker_count; i++)
+    {
+      cut_worker_t* counted = (i < 0) ? &g_cut_main_worker : &g_cut->workers[i];
+
+      for (r = CUT_RESULT_FIRST; r <= CUT_RESULT_LAST; r++)
+      {
+        g_cut->assertions[r] += counted->done_assertions[r];
+        g_cut->tests[r] += counted->done_tests[r];
+      }
+    }
+
+    g_cut->assertions[CUT_RESULT_ERROR]++;
+    g_cut->tests[CUT_RESULT_ERROR]++;
+    printf("\n");
+    cut_print_summary(stdout, CUT_RESULT_ERROR);
+  }
+
+  fflush(stdout);
+  fprintf(stderr, "cut: %s%s timed out; stopping the run\n", CUT_TEST_NAME(test));
+  fflush(stderr);
+  _exit(CUT_RESULT_ERROR);
+}   /* cut_watchdog_expire() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Thread function for the watchdog: checks the test on each worker against
+ * its deadline until told to stop.
+ */
+static void cut_watchdog_main(void* arg)
+{
+  (void) arg;
+
+  for (;;)
+  {
+    usec_t now = 0;
+    usec_t wait = CUT_WATCHDOG_USEC;
+    int i = 0;
+
+    cut_mutex_lock(&g_cut->lock);
+
+    if (g_cut->watchdog_stop)
+    {
+      cut_mutex_unlock(&g_cut->lock);
+      break;
+    }
+
+    now = usec_time();
+
+    for (i = -1; i < g_cut->worker_count; i++)
+    {
+      cut_worker_t* worker = (i < 0) ? &g_cut_main_worker : &g_cut->workers[i];
+
+      if (NULL == worker->watch_test)
+      {
+        continue;
+      }
+
+      if (now >= worker->watch_deadline)
+      {
+        cut_watchdog_expire(worker, now);
+      }
+
+      if (worker->watch_deadline - now < wait)
+      {
+        wait = worker->watch_deadline - now;
+      }
+    }
+
+    cut_mutex_unlock(&g_cut->lock);
+    cut_sleep_usec(wait);
+  }
+}   /* cut_watchdog_main() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Starts the watchdog thread if any test in the run list has a time limit.
+ */
+static void cut_watchdog_start(void)
+{
+  size_t i = 0;
+
+  for (i = 0; i < g_cut->run_count; i++)
+  {
+    if (cut_test_timeout(g_cut->run[i]) > 0)
+    {
+      break;
+    }
+  }
+
+  if (i < g_cut->run_count)
+  {
+    g_cut->watchdog_stop = 0;
+
+    if (CUT_RESULT_PASS == cut_thread_start(&g_cut->watchdog, cut_watchdog_main, NULL))
+    {
+      g_cut->watching = 1;
+    }
+    else
+    {
+      fprintf(stderr, "cut: could not start the watchdog; tests will not time out\n");
+    }
+  }
+}   /* cut_watchdog_start() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Stops the watchdog thread, if it is running.
+ */
+static void cut_watchdog_stop(void)
+{
+  if (g_cut->watching)
+  {
+    cut_mutex_lock(&g_cut->lock);
+    g_cut->watchdog_stop = 1;
+    cut_mutex_unlock(&g_cut->lock);
+    cut_thread_join(&g_cut->watchdog);
+    g_cut->watching = 0;
+  }
+}   /* cut_watchdog_stop() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Builds the list of tests to be run, g_cut->run, in suite order. Tests
+ * belonging to other shards are left out. Suites installed lazily may have
+ * their tests after those of later suites in g_cut->test.
+ *
+ * @return CUT_RESULT_PASS on success, CUT_RESULT_ERROR if out of memory.
+ */
+static cut_result_t cut_build_run_list(void)
+{
+  cut_suite_t* suite = NULL;
+  cut_test_t*  test = NULL;
+  size_t       count = 0;
+
+  for (test = g_cut->test; test < &g_cut->test[g_cut->test_count]; test++)
+  {
+    count += !(test->flags & CUT_TEST_FLAG_OTHER_SHARD);
+  }
+
+  free(g_cut->run);
+  g_cut->run = (cut_test_t**) malloc((count > 0 ? count : 1) * sizeof(g_cut->run[0]));
+  g_cut->run_count = 0;
+  g_cut->run_next = 0;
+
+  if (NULL == g_cut->run)
+  {
+    return CUT_RESULT_ERROR;
+  }
+
+  for (suite = g_cut->suite; suite < &g_cut->suite[g_cut->suite_count]; suite++)
+  {
+    for (test = &g_cut->test[suite->first]; test < &g_cut->test[suite->first + suite->count]; test++)
+    {
+      if (!(test->flags & CUT_TEST_FLAG_OTHER_SHARD))
+      {
+        g_cut->run[g_cut->run_count++] = test;
+      }
+    }
+  }
+
+  return CUT_RESULT_PASS;
+}   /* cut_build_run_list() */
+
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Builds a hash table of all registered tests, keyed by full name.
+ *
+ * @param size - receives the number of entries in the table, a power of 2.
+ *
+ * @return the table, or NULL if out of memory. Free it with free().
+ */
+static cut_test_t** cut_build_test_table(size_t* size)
+{
+  cut_test_t** table = NULL;
+  cut_test_t*  test = NULL;
+  size_t count = 0;
+
+  for (test = g_cut->test; test < &g_cut->test[g_cut->test_count]; test++)
+  {
+    count++;
+  }
+
+  for (*size = 16; *size < 2 * count; *size *= 2)
+  {
+  }
+
+  table = (cut_test_t**) calloc(*size, sizeof(table[0]));
+
+  if (NULL == table)
+  {
+    return NULL;
+  }
+
+  for (test = g_cut->test; test < &g_cut->test[g_cut->test_count]; test++)
+  {
+    size_t i = cut_hash_test_name(test) & (*size - 1);
+
+    while (NULL != table[i])
+    {
+      i = (i + 1) & (*size - 1);
+    }
+
+    table[i] = test;
+  }
+
+  return table;
+}   /* cut_build_test_table() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the test in @a table (of @a size entries) called @a name, or NULL.
+ */
+static cut_test_t* cut_find_test(cut_test_t** table, size_t size, const char* name)
+{
+  size_t i = cut_hash_string(name) & (size - 1);
+
+  for (; NULL != table[i]; i = (i + 1) & (size - 1))
+  {
+    if (cut_test_name_is(table[i], name))
+    {
+      return table[i];
+    }
+  }
+
+  return NULL;
+}   /* cut_find_test() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Appends @a line to the history lines that belong to no registered test.
+ */
+static void cut_history_keep(const char* line)
+{
+  size_t len = strlen(line);
+  char* extra = (char*) realloc(g_cut->history_extra, g_cut->history_extra_len + len + 1);
+
+  if (NULL != extra)
+  {
+    memcpy(&extra[g_cut->history_extra_len], line, len + 1);
+    g_cut->history_extra = extra;
+    g_cut->history_extra_len += len;
+  }
+}   /* cut_history_keep() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Reads one line of file into *buffer, growing it as needed so names of any
+ * length fit. The line always ends with a newline, even when the file does
+ * not. Returns *buffer, or NULL at the end of the file or when out of
+ * memory.
+ */
+static char* cut_read_line(FILE* file, char** buffer, size_t* size)
+{
+  size_t len = 0;
+  int at_end = 0;
+
+  assert(file);
+  assert(buffer);
+  assert(size);
+
+  for (;;)
+  {
+    if (*size - len < 2)
+    {
+      size_t new_size = (0 == *size) ? 0x100 : 2 * *size;
+      char* new_buffer = (char*) realloc(*buffer, new_size);
+
+      if (NULL == new_buffer)
+      {
+        return NULL;
+      }
+
+      *buffer = new_buffer;
+      *size = new_size;
+    }
+
+    if (at_end)
+    {
+      (*buffer)[len++] = '\n';
+      (*buffer)[len] = 0;
+      return *buffer;
+    }
+
+    if (NULL == fgets(&(*buffer)[len], (int) (*size - len), file))
+    {
+      if (0 == len)
+      {
+        return NULL;
+      }
+
+      at_end = 1;
+      continue;
+    }
+
+    len += strlen(&(*buffer)[len]);
+
+    if ((len > 0) && ('\n' == (*buffer)[len - 1]))
+    {
+      return *buffer;
+    }
+  }
+}   /* cut_read_line() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Reads test durations and results from cut_history_file, if any. Each line
+ * of the file is a duration in microseconds, a tab, the result name, another
+ * tab and the full test name. The result and its tab are missing from files
+ * written before results were kept.
+ */
+static void cut_history_load(void)
+{
+  char* line = NULL;
+  size_t line_size = 0;
+  cut_test_t** table = NULL;
+  size_t size = 0;
+  FILE* file = NULL;
+
+  free(g_cut->history_extra);
+  g_cut->history_extra = NULL;
+  g_cut->history_extra_len = 0;
+
+  if ((NULL == cut_history_file) || (NULL == (file = fopen(cut_history_file, "r"))))
+  {
+    return;
+  }
+
+  table = cut_build_test_table(&size);
+
+  while ((NULL != table) && (NULL != cut_read_line(file, &line, &line_size)))
+  {
+    char* name = NULL;
+    char* end = NULL;
+    unsigned long long usec = strtoull(line, &name, 10);
+    cut_test_t* test = NULL;
+    int result = -1;
+    int i = 0;
+
+    if (('#' == line[0]) || (name == line) || ('\t' != *name))
+    {
+      continue;
+    }
+
+    name++;
+
+    for (i = CUT_RESULT_FIRST; i <= CUT_RESULT_LAST; i++)
+    {
+      size_t len = strlen(cut_result_name[i]);
+
+      if ((0 == strncmp(name, cut_result_name[i], len)) && ('\t' == name[len]))
+      {
+        result = i;
+        name += len + 1;
+        break;
+      }
+    }
+
+    end = &name[strcspn(name, "\r\n")];
+
+    *end = 0;
+    test = cut_find_test(table, size, name);
+
+    if (NULL != test)
+    {
+      test->usec = usec;
+      test->flags |= CUT_TEST_FLAG_HISTORY;
+
+      if (result >= 0)
+      {
+        test->result = (cut_result_t) result;
+        test->flags |= CUT_TEST_FLAG_RESULT;
+      }
+    }
+    else
+    {
+      *end = '\n';
+      cut_history_keep(line);
+    }
+  }
+
+  free(line);
+  free(table);
+  fclose(file);
+}   /* cut_history_load() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Writes the duration and result of every test with a known duration to
+ * cut_history_file. The file is replaced only once it is completely
+ * written.
+ */
+static void cut_history_save(void)
+{
+  cut_test_t*  test = NULL;
+  char* temp_name = NULL;
+  FILE* file = NULL;
+  int ok = 1;
+
+  if (NULL == cut_history_file)
+  {
+    return;
+  }
+
+  temp_name = (char*) malloc(strlen(cut_history_file) + 5);
+
+  if (NULL == temp_name)
+  {
+    return;
+  }
+
+  sprintf(temp_name, "%s.tmp", cut_history_file);
+
+  if (NULL == (file = fopen(temp_name, "w")))
+  {
+    fprintf(stderr, "cut: could not write history file \"%s\"\n", temp_name);
+    free(temp_name);
+    return;
+  }
+
+  fprintf(file, "# cut test history: <microseconds><tab><result><tab><suite.test>\n");
+
+  for (test = g_cut->test; test < &g_cut->test[g_cut->test_count]; test++)
+  {
+    if (!(test->flags & (CUT_TEST_FLAG_TIMED | CUT_TEST_FLAG_HISTORY)))
+    {
+      continue;
+    }
+
+    if (test->flags & CUT_TEST_FLAG_RESULT)
+    {
+      fprintf(file, "%llu\t%s\t%s%s\n", (unsigned long long) test->usec, cut_result_name[test->result], CUT_TEST_NAME(test));
+    }
+    else
+    {
+      fprintf(file, "%llu\t%s%s\n", (unsigned long long) test->usec, CUT_TEST_NAME(test));
+    }
+  }
+
+  if (g_cut->history_extra_len > 0)
+  {
+    fwrite(g_cut->history_extra, 1, g_cut->history_extra_len, file);
+  }
+
+  ok = !ferror(file);
+  ok = (0 == fclose(file)) && ok;
+#if defined(_WIN32)
+  remove(cut_history_file);
+#endif
+
+  if (!ok || (0 != rename(temp_name, cut_history_file)))
+  {
+    fprintf(stderr, "cut: could not write history file \"%s\"\n", cut_history_file);
+    remove(temp_name);
+  }
+
+  free(temp_name);
+}   /* cut_history_save() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Reads the next line of a benchmark file, made of runs in nanoseconds per
+ * iteration separated by spaces, a tab and the full benchmark name. Skips
+ * comments and lines not in that form.
+ *
+ * @return the line (in *buffer) split at the tab, with the runs in *runs and
+ * the name in *name, or NULL at the end of the file.
+ */
+static char* cut_bench_read_line(FILE* file, char** buffer, size_t* size, char** runs, char** name)
+{
+  char* line = NULL;
+
+  while (NULL != (line = cut_read_line(file, buffer, size)))
+  {
+    char* tab = strchr(line, '\t');
+
+    if (('#' != line[0]) && (NULL != tab))
+    {
+      *tab = 0;
+      *runs = line;
+      *name = tab + 1;
+      (*name)[strcspn(*name, "\r\n")] = 0;
+      return line;
+    }
+  }
+
+  return NULL;
+}   /* cut_bench_read_line() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Sets up g_cut->bench when benchmarks are compared or saved, reading the
+ * runs of each registered benchmark from cut_benchmark_baseline.
+ *
+ * @return CUT_RESULT_PASS on success, CUT_RESULT_ERROR if out of memory.
+ */
+static cut_result_t cut_bench_load(void)
+{
+  char* line = NULL;
+  size_t line_size = 0;
+  char* runs = NULL;
+  char* name = NULL;
+  cut_test_t** table = NULL;
+  size_t size = 0;
+  FILE* file = NULL;
+
+  if ((NULL == cut_benchmark_baseline) && (NULL == cut_benchmark_save))
+  {
+    return CUT_RESULT_PASS;
+  }
+
+  cut_benchmark = 1;
+  g_cut->bench = (cut_bench_runs_t*) calloc(g_cut->test_count + 1, sizeof(cut_bench_runs_t));
+
+  if (NULL == g_cut->bench)
+  {
+    return CUT_RESULT_ERROR;
+  }
+
+  if (NULL == cut_benchmark_baseline)
+  {
+    return CUT_RESULT_PASS;
+  }
+
+  if (NULL == (file = fopen(cut_benchmark_baseline, "r")))
+  {
+    fprintf(stderr, "cut: could not read benchmark baseline \"%s\"\n", cut_benchmark_baseline);
+    return CUT_RESULT_PASS;
+  }
+
+  table = cut_build_test_table(&size);
+
+  while ((NULL != table) && (NULL != cut_bench_read_line(file, &line, &line_size, &runs, &name)))
+  {
+    cut_test_t* test = cut_find_test(table, size, name);
+    cut_bench_runs_t* baseline = NULL;
+    char* end = NULL;
+    int count = 0;
+
+    if ((NULL == test) || !(test->flags & CUT_TEST_FLAG_BENCHMARK))
+    {
+      continue;
+    }
+
+    baseline = &g_cut->bench[test - g_cut->test];
+    free(baseline->base);
+    baseline->base = (double*) malloc((strlen(runs) / 2 + 1) * sizeof(double));
+    baseline->base_count = 0;
+
+    for (; NULL != baseline->base; count++, runs = end)
+    {
+      double nsec = strtod(runs, &end);
+
+      if (end == runs)
+      {
+        break;
+      }
+
+      baseline->base[count] = nsec;
+    }
+
+    if (NULL != baseline->base)
+    {
+      qsort(baseline->base, count, sizeof(double), cut_compare_double);
+      baseline->base_count = count;
+    }
+  }
+
+  free(line);
+  free(table);
+  fclose(file);
+  return (NULL != table) ? CUT_RESULT_PASS : CUT_RESULT_ERROR;
+}   /* cut_bench_load() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Writes the runs of the benchmarks measured in this run to
+ * cut_benchmark_save, along with the lines already in it for benchmarks
+ * that were not, then frees g_cut->bench. The file is replaced only once it
+ * is completely written.
+ */
+static void cut_bench_save(void)
+{
+  cut_test_t* test = NULL;
+  char* line = NULL;
+  size_t line_size = 0;
+  char* runs = NULL;
+  char* name = NULL;
+  cut_test_t** table = NULL;
+  size_t size = 0;
+  char* temp_name = NULL;
+  FILE* old_file = NULL;
+  FILE* file = NULL;
+  int ok = 1;
+  int i = 0;
+
+  if (NULL == g_cut->bench)
+  {
+    return;
+  }
+
+  if ((NULL != cut_benchmark_save) && (NULL != (temp_name = (char*) malloc(strlen(cut_benchmark_save) + 5))))
+  {
+    sprintf(temp_name, "%s.tmp", cut_benchmark_save);
+    file = fopen(temp_name, "w");
+    ok = (NULL != file);
+  }
+
+  if (NULL != file)
+  {
+    fprintf(file, "# cut benchmark runs: <nanoseconds per iteration>...<tab><suite.test>\n");
+
+    for (test = g_cut->test; test < &g_cut->test[g_cut->test_count]; test++)
+    {
+      const cut_bench_runs_t* measured = &g_cut->bench[test - g_cut->test];
+
+      for (i = 0; i < measured->count; i++)
+      {
+        fprintf(file, "%s%.3f", (i > 0) ? " " : "", measured->nsec[i]);
+      }
+
+      if (measured->count > 0)
+      {
+        fprintf(file, "\t%s%s\n", CUT_TEST_NAME(test));
+      }
+    }
+
+    /*
+     * Keep the benchmarks that this run did not measure.
+     */
+    if ((NULL != (old_file = fopen(cut_benchmark_save, "r"))) && (NULL != (table = cut_build_test_table(&size))))
+    {
+      while (NULL != cut_bench_read_line(old_file, &line, &line_size, &runs, &name))
+      {
+        test = cut_find_test(table, size, name);
+
+        if ((NULL == test) || (0 == g_cut->bench[test - g_cut->test].count))
+        {
+          fprintf(file, "%s\t%s\n", runs, name);
+        }
+      }
+    }
+
+    if (NULL != old_file)
+    {
+      fclose(old_file);
+    }
+
+    ok = !ferror(file) && ((NULL == old_file) || (NULL != table));
+    ok = (0 == fclose(file)) && ok;
+#if defined(_WIN32)
+    remove(cut_benchmark_save);
+#endif
+    ok = ok && (0 == rename(temp_name, cut_benchmark_save));
+
+    if (!ok)
+    {
+      remove(temp_name);
+    }
+  }
+
+  if (!ok)
+  {
+    fprintf(stderr, "cut: could not write benchmark file \"%s\"\n", cut_benchmark_save);
+  }
+
+  for (i = 0; i < (int) g_cut->test_count; i++)
+  {
+    free(g_cut->bench[i].base);
+    free(g_cut->bench[i].nsec);
+  }
+
+  free(g_cut->bench);
+  g_cut->bench = NULL;
+  free(line);
+  free(table);
+  free(temp_name);
+}   /* cut_bench_save() */
+
+/**
+ * Entry for sorting the run list, keeping the position so that the sort is
+ * stable.
+ */
+typedef struct cut_sort_entry_s
+{
+  cut_test_t* test;
+  size_t position;
+} cut_sort_entry_t;
+
+/* ------------------------------------------------------------------------- */
+static int cut_compare_expected(const void* a, const void* b)
+{
+  const cut_sort_entry_t* ea = (const cut_sort_entry_t*) a;
+  const cut_sort_entry_t* eb = (const cut_sort_entry_t*) b;
+
+  if (ea->test->expected_usec != eb->test->expected_usec)
+  {
+    return (ea->test->expected_usec > eb->test->expected_usec) ? -1 : 1;
+  }
+
+  return (ea->position < eb->position) ? -1 : (ea->position > eb->position);
+}   /* cut_compare_expected() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Sets the expected duration of every test from its history. A test with no
+ * history is expected to take as long as the average of the other tests in
+ * its suite, or of all tests if the suite has no history. Excluded tests do
+ * not run and are expected to take no time.
+ *
+ * @return the number of tests with history; if 0, no estimates are made.
+ */
+static size_t cut_estimate_durations(void)
+{
+  cut_suite_t* suite = NULL;
+  cut_test_t*  test = NULL;
+  usec_t total = 0;
+  size_t count = 0;
+
+  for (test = g_cut->test; test < &g_cut->test[g_cut->test_count]; test++)
+  {
+    if (test->flags & CUT_TEST_FLAG_HISTORY)
+    {
+      total += test->usec;
+      count++;
+    }
+  }
+
+  if (0 == count)
+  {
+    return 0;
+  }
+
+  for (suite = g_cut->suite; suite < &g_cut->suite[g_cut->suite_count]; suite++)
+  {
+    cut_test_t* end = &g_cut->test[suite->first + suite->count];
+    usec_t suite_total = 0;
+    size_t suite_count = 0;
+    usec_t estimate = total / count;
+
+    for (test = &g_cut->test[suite->first]; test < end; test++)
+    {
+      if (test->flags & CUT_TEST_FLAG_HISTORY)
+      {
+        suite_total += test->usec;
+        suite_count++;
+      }
+    }
+
+    if (suite_count > 0)
+    {
+      estimate = suite_total / suite_count;
+    }
+
+    for (test = &g_cut->test[suite->first]; test < end; test++)
+    {
+      test->expected_usec = (test->flags & CUT_TEST_FLAG_HISTORY) ? test->usec : estimate;
+
+      if (test->flags & CUT_TEST_FLAG_EXCLUDE)
+      {
+        test->expected_usec = 0;
+      }
+    }
+  }
+
+  return count;
+}   /* cut_estimate_durations() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Orders the run list longest-expected-first so that a slow test does not
+ * start last and stretch a parallel run. Without any history the order is
+ * unchanged.
+ */
+static void cut_schedule_run_list(void)
+{
+  cut_sort_entry_t* entries = NULL;
+  size_t i = 0;
+
+  if ((g_cut->run_count < 2) || (0 == cut_estimate_durations()))
+  {
+    return;
+  }
+
+  entries = (cut_sort_entry_t*) malloc(g_cut->run_count * sizeof(entries[0]));
+
+  if (NULL == entries)
+  {
+    return;
+  }
+
+  for (i = 0; i < g_cut->run_count; i++)
+  {
+    entries[i].test = g_cut->run[i];
+    entries[i].position = i;
+  }
+
+  qsort(entries, g_cut->run_count, sizeof(entries[0]), cut_compare_expected);
+
+  for (i = 0; i < g_cut->run_count; i++)
+  {
+    g_cut->run[i] = entries[i].test;
+  }
+
+  free(entries);
+}   /* cut_schedule_run_list() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return non-zero if @a test failed (FAIL or ERROR) the last time it ran.
+ */
+static int cut_test_failed(const cut_test_t* test)
+{
+  return (test->flags & CUT_TEST_FLAG_RESULT) &&
+         ((CUT_RESULT_FAIL == test->result) || (CUT_RESULT_ERROR == test->result));
+}   /* cut_test_failed() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Excludes every selected test that did not fail last time, as for
+ * cut_failed_only. If none of them failed, all of them are left to run.
+ */
+static void cut_select_failed(void)
+{
+  cut_test_t*  test = NULL;
+  size_t failed = 0;
+
+  for (test = g_cut->test; test < &g_cut->test[g_cut->test_count]; test++)
+  {
+    failed += !(test->flags & CUT_TEST_FLAG_EXCLUDE) && cut_test_failed(test);
+  }
+
+  if (0 == failed)
+  {
+    fprintf(stderr, "cut: no failures recorded in the last run; running all selected tests\n");
+    return;
+  }
+
+  for (test = g_cut->test; test < &g_cut->test[g_cut->test_count]; test++)
+  {
+    if (!cut_test_failed(test))
+    {
+      test->flags |= CUT_TEST_FLAG_EXCLUDE;
+    }
+  }
+}   /* cut_select_failed() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Moves the tests that failed last time to the front of the run list,
+ * keeping the order within the failed tests and within the rest.
+ */
+static void cut_run_failed_first(void)
+{
+  cut_test_t** run = NULL;
+  size_t count = 0;
+  size_t i = 0;
+
+  if (g_cut->run_count < 2)
+  {
+    return;
+  }
+
+  run = (cut_test_t**) malloc(g_cut->run_count * sizeof(run[0]));
+
+  if (NULL == run)
+  {
+    return;
+  }
+
+  for (i = 0; i < g_cut->run_count; i++)
+  {
+    if (cut_test_failed(g_cut->run[i]))
+    {
+      run[count++] = g_cut->run[i];
+    }
+  }
+
+  for (i = 0; i < g_cut->run_count; i++)
+  {
+    if (!cut_test_failed(g_cut->run[i]))
+    {
+      run[count++] = g_cut->run[i];
+    }
+  }
+
+  free(g_cut->run);
+  g_cut->run = run;
+}   /* cut_run_failed_first() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Sort order for balanced sharding: longest first, then by name. Only the
+ * names and the history are used, so every machine sorts the same way.
+ */
+static int cut_compare_shard(const void* a, const void* b)
+{
+  const cut_test_t* ta = *(const cut_test_t* const*) a;
+  const cut_test_t* tb = *(const cut_test_t* const*) b;
+
+  if (ta->expected_usec != tb->expected_usec)
+  {
+    return (ta->expected_usec > tb->expected_usec) ? -1 : 1;
+  }
+
+  if (cut_test_suite(ta)->prefix != cut_test_suite(tb)->prefix)
+  {
+    int rval = strcmp(cut_test_suite(ta)->prefix, cut_test_suite(tb)->prefix);
+
+    if (0 != rval)
+    {
+      return rval;
+    }
+  }
+
+  return strcmp(g_cut->test_name[ta - g_cut->test], g_cut->test_name[tb - g_cut->test]);
+}   /* cut_compare_shard() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Marks every test that does not belong to shard cut_shard_index (of
+ * cut_shard_count) with CUT_TEST_FLAG_OTHER_SHARD.
+ *
+ * When history is in use, the tests that will run are dealt longest first
+ * into whichever shard has the least total expected time, which balances
+ * the shards. Otherwise, and for excluded tests, a test's shard comes from
+ * a stable hash of its full name.
+ */
+static void cut_assign_shards(void)
+{
+  cut_test_t** tests = NULL;
+  usec_t* load = NULL;
+  cut_test_t*  test = NULL;
+  size_t count = 0;
+  size_t i = 0;
+  int balance = 0;
+
+  for (test = g_cut->test; test < &g_cut->test[g_cut->test_count]; test++)
+  {
+    test->flags &= ~CUT_TEST_FLAG_OTHER_SHARD;
+    count++;
+  }
+
+  if (cut_shard_count <= 1)
+  {
+    return;
+  }
+
+  balance = (NULL != cut_history_file) && (cut_estimate_durations() > 0);
+
+  if (balance)
+  {
+    tests = (cut_test_t**) malloc((count > 0 ? count : 1) * sizeof(tests[0]));
+    load = (usec_t*) calloc(cut_shard_count, sizeof(load[0]));
+    balance = (NULL != tests) && (NULL != load);
+  }
+
+  count = 0;
+
+  for (test = g_cut->test; test < &g_cut->test[g_cut->test_count]; test++)
+  {
+    if (balance && !(test->flags & CUT_TEST_FLAG_EXCLUDE))
+    {
+      tests[count++] = test;
+    }
+    else if ((int) (cut_hash_test_name(test) % cut_shard_count) != cut_shard_index)
+    {
+      test->flags |= CUT_TEST_FLAG_OTHER_SHARD;
+    }
+  }
+
+  if (balance)
+  {
+    qsort(tests, count, sizeof(tests[0]), cut_compare_shard);
+
+    for (i = 0; i < count; i++)
+    {
+      int shard = 0;
+      int j = 0;
+
+      for (j = 1; j < cut_shard_count; j++)
+      {
+        if (load[j] < load[shard])
+        {
+          shard = j;
+        }
+      }
+
+      /*
+       * Count every test as taking at least a microsecond so that tests
+       * with no measurable time are still spread out.
+       */
+      load[shard] += (tests[i]->expected_usec > 0) ? tests[i]->expected_usec : 1;
+
+      if (shard != cut_shard_index)
+      {
+        tests[i]->flags |= CUT_TEST_FLAG_OTHER_SHARD;
+      }
+    }
+  }
+
+  free(tests);
+  free(load);
+}   /* cut_assign_shards() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Thread function for parallel workers: takes tests from the shared run
+ * list until it is exhausted.
+ */
+static void cut_worker_main(void* arg)
+{
+  cut_worker_t* worker = (cut_worker_t*) arg;
+
+  assert(NULL != worker);
+  g_cut_worker = worker;
+
+  for (;;)
+  {
+    size_t index = 0;
+
+    cut_mutex_lock(&g_cut->lock);
+    index = g_cut->run_next++;
+    cut_mutex_unlock(&g_cut->lock);
+
+    if (index >= g_cut->run_count)
+    {
+      break;
+    }
+
+    cut_run_test(worker, g_cut->run[index]);
+  }
+
+  /*
+   * The counters only count this thread, so the next run opens new ones.
+   */
+  cut_perf_close(worker);
+  g_cut_worker = &g_cut_main_worker;
+}   /* cut_worker_main() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Adds the counts of @a worker, and its assertion sites, into the global
+ * totals.
+ */
+static void cut_merge_worker(cut_worker_t* worker)
+{
+  int i = 0;
+
+  for (i = CUT_RESULT_FIRST; i <= CUT_RESULT_LAST; i++)
+  {
+    g_cut->assertions[i] += worker->assertions[i];
+    g_cut->tests[i] += worker->tests[i];
+  }
+
+  for (i = 0; i < CUT_PERF_PHASES * CUT_PERF_COUNT; i++)
+  {
+    g_cut->perf_total[i / CUT_PERF_COUNT][i % CUT_PERF_COUNT] += worker->perf_total[i / CUT_PERF_COUNT][i % CUT_PERF_COUNT];
+  }
+
+  g_cut->perf_have |= worker->perf_have;
+  worker->perf_have = 0;
+  memset(worker->perf_total, 0, sizeof(worker->perf_total));
+  cut_site_merge(&g_cut->sites, &worker->sites);
+}   /* cut_merge_worker() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs every test in the run list on @a jobs threads.
+ *
+ * @return CUT_RESULT_PASS if all workers were started, CUT_RESULT_ERROR
+ * otherwise (any tests not taken by a worker are then run serially).
+ */
+static cut_result_t cut_run_threads(int jobs)
 {
-  static char shared_image[CHAR_IMAGE_MAX_LEN] = "";
+  cut_result_t result = CUT_RESULT_PASS;
+  cut_worker_t* workers = NULL;
+  int started = 0;
+  int i = 0;
 
-  image = (NULL == image) ? shared_image : image;
+  assert(jobs > 1);
 
-  switch (c)
+  workers = (cut_worker_t*) calloc(jobs, sizeof(workers[0]));
+
+  if (NULL == workers)
   {
-  case '\'': strncpy(image, "'\\''", CHAR_IMAGE_MAX_LEN); break;
-  case '\t': strncpy(image, "'\\t'", CHAR_IMAGE_MAX_LEN); break;
-  case '\r': strncpy(image, "'\\r'", CHAR_IMAGE_MAX_LEN); break;
-  case '\n': strncpy(image, "'\\n'", CHAR_IMAGE_MAX_LEN); break;
+    return CUT_RESULT_ERROR;
+  }
 
-  default:
-    if (isprint(c))
+  cut_mutex_lock(&g_cut->lock);
+  g_cut->workers = workers;
+  g_cut->worker_count = jobs;
+  cut_mutex_unlock(&g_cut->lock);
+
+  for (started = 0; started < jobs; started++)
+  {
+    workers[started].buffered = 1;
+
+    if (CUT_RESULT_PASS != cut_thread_start(&workers[started].thread, cut_worker_main, &workers[started]))
     {
-      image[0] = '\'';
-      image[1] = c;
-      image[2] = '\'';
-      image[3] = 0;
-      return image;
+      result = CUT_RESULT_ERROR;
+      break;
     }
-    if (c < 10) snprintf(image, CHAR_IMAGE_MAX_LEN - 1, "'\\%u'", (unsigned) (unsigned char) c);
-    else        snprintf(image, CHAR_IMAGE_MAX_LEN - 1, "'\\x%02X'", (unsigned) (unsigned char) c);
   }
 
-  image[CHAR_IMAGE_MAX_LEN-1] = 0;
-  return image;
-}   /* char_image() */
+  for (i = 0; i < started; i++)
+  {
+    cut_thread_join(&workers[i].thread);
+  }
+
+  cut_mutex_lock(&g_cut->lock);
+  g_cut->workers = NULL;
+  g_cut->worker_count = 0;
+  cut_mutex_unlock(&g_cut->lock);
+
+  for (i = 0; i < started; i++)
+  {
+    cut_merge_worker(&workers[i]);
+    free(workers[i].data);
+    free(workers[i].out);
+    free(workers[i].allocs.live);
+  }
+
+  free(workers);
+  return result;
+}   /* cut_run_threads() */
+
+#if !defined(_WIN32)
+/**
+ * A running isolated test: the child process and what it has sent so far.
+ */
+typedef struct cut_slot_s
+{
+  /**
+   * Test being run, or NULL if the slot is free.
+   */
+  cut_test_t* test;
+
+  /**
+   * Child process and the read end of its report pipe.
+   */
+  pid_t pid;
+  int fd;
+
+  /**
+   * Raw bytes received from the child that do not yet form a whole frame.
+   */
+  char* in;
+  size_t in_len;
+  size_t in_size;
+
+  /**
+   * Set once the child has sent its result.
+   */
+  int have_report;
+  cut_report_t report;
+
+  /**
+   * Set once the child's wait status is known.
+   */
+  int have_status;
+  int status;
+
+  /**
+   * Start time of the test, for tests that do not report.
+   */
+  usec_t start_time;
+  struct tm stamp;
+
+  /**
+   * When the test's time is up (0 if it has no limit), and whether the child
+   * was killed for running past it.
+   */
+  usec_t deadline;
+  int timed_out;
+
+  /**
+   * Collects the child's output and anything the parent adds to it.
+   */
+  cut_worker_t out;
+} cut_slot_t;
 
 /* ------------------------------------------------------------------------- */
-static char* printable_diff_string(char* printable, const char* src, size_t len, size_t diff_index)
+/**
+ * @return the name of signal @a sig, such as "SIGSEGV".
+ */
+static const char* cut_signal_name(int sig)
 {
-  const size_t half_len = (PRINTABLE_DIFF_STRING_MAX_LEN / 2) - 2;   /* Allow for two dots on either side. */
+  static CUT_THREAD_LOCAL char unknown[0x20] = "";
 
-  assert(src && printable);
+  switch (sig)
+  {
+  case SIGABRT: return "SIGABRT";
+  case SIGALRM: return "SIGALRM";
+  case SIGBUS:  return "SIGBUS";
+  case SIGFPE:  return "SIGFPE";
+  case SIGHUP:  return "SIGHUP";
+  case SIGILL:  return "SIGILL";
+  case SIGINT:  return "SIGINT";
+  case SIGKILL: return "SIGKILL";
+  case SIGPIPE: return "SIGPIPE";
+  case SIGQUIT: return "SIGQUIT";
+  case SIGSEGV: return "SIGSEGV";
+  case SIGTERM: return "SIGTERM";
+  case SIGTRAP: return "SIGTRAP";
+  case SIGUSR1: return "SIGUSR1";
+  case SIGUSR2: return "SIGUSR2";
+  default:
+    snprintf(unknown, sizeof(unknown), "signal %d", sig);
+    return unknown;
+  }
+}   /* cut_signal_name() */
 
-  if (len < PRINTABLE_DIFF_STRING_MAX_LEN)
+/* ------------------------------------------------------------------------- */
+/**
+ * Body of the child process for an isolated test: runs @a test, sending its
+ * output and result over @a fd. Does not return.
+ */
+static void cut_isolated_child(cut_test_t* test, int fd)
+{
+  cut_worker_t* worker = &g_cut_main_worker;
+  cut_report_t report;
+  int32_t pid = 0;
+  int i = 0;
+
+  memset(worker, 0, sizeof(*worker));
+  worker->buffered = 1;
+  worker->report = 1;
+  worker->report_fd = fd;
+  g_cut_worker = worker;
+
+  /*
+   * A forkserver's parent does not otherwise know which process to kill if
+   * the test times out.
+   */
+  pid = getpid();
+  cut_write_frame(fd, CUT_FRAME_PID, &pid, sizeof(pid));
+
+  memset(&report, 0, sizeof(report));
+  report.result = cut_run_test(worker, test);
+  report.usec = test->usec;
+  report.perf_have = worker->perf_have;
+  memcpy(report.perf, worker->perf_total, sizeof(report.perf));
+
+  for (i = CUT_RESULT_FIRST; i <= CUT_RESULT_LAST; i++)
   {
-    /*
-     * If there's no need to truncate.
-     */
-    strncpy(printable, src, PRINTABLE_DIFF_STRING_MAX_LEN-1);
+    report.assertions[i] = worker->assertions[i];
   }
-  else if (diff_index > half_len)
+
+  fflush(stdout);
+  cut_write_frame(fd, CUT_FRAME_RESULT, &report, sizeof(report));
+  close(fd);
+  _exit(0);
+}   /* cut_isolated_child() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Starts @a test in a child process on @a slot, forked directly from this
+ * process.
+ *
+ * @return CUT_RESULT_PASS on success, CUT_RESULT_ERROR if the process could
+ * not be started.
+ */
+static cut_result_t cut_slot_fork(cut_slot_t* slot, cut_slot_t* slots, int slot_count, cut_test_t* test)
+{
+  int fds[2] = { -1, -1 };
+  int i = 0;
+
+  assert(NULL != slot);
+  assert(NULL != test);
+
+  if (0 != pipe(fds))
   {
-    /*
-     * If the difference appears more than halfway through the buffer, use a
-     * leading ellipsis.
-     */
-    printable[0] = '.';
-    printable[2] = '.';
-    strncpy(&printable[2], &src[diff_index - half_len], PRINTABLE_DIFF_STRING_MAX_LEN-1-2);
+    return CUT_RESULT_ERROR;
+  }
 
-    if (len > (diff_index + half_len))
-    {
-      /*
-       * If a trailing ellipsis is needed, too.
-       */
-      printable[PRINTABLE_DIFF_STRING_MAX_LEN-1-2] = '.';
-      printable[PRINTABLE_DIFF_STRING_MAX_LEN-1-1] = '.';
-    }
+  /*
+   * Anything buffered now would be printed again by the child.
+   */
+  fflush(stdout);
+  fflush(stderr);
+
+  slot->pid = fork();
+
+  if (slot->pid < 0)
+  {
+    close(fds[0]);
+    close(fds[1]);
+    return CUT_RESULT_ERROR;
   }
-  else   /* else the difference occurs early in a long string... */
+
+  if (0 == slot->pid)
   {
-    strncpy(printable, src, PRINTABLE_DIFF_STRING_MAX_LEN-1);
-    printable[PRINTABLE_DIFF_STRING_MAX_LEN-1-2] = '.';
-    printable[PRINTABLE_DIFF_STRING_MAX_LEN-1-1] = '.';
+    close(fds[0]);
+
+    for (i = 0; i < slot_count; i++)
+    {
+      if (NULL != slots[i].test)
+      {
+        close(slots[i].fd);
+      }
+    }
+
+    cut_isolated_child(test, fds[1]);
   }
 
-  printable[PRINTABLE_DIFF_STRING_MAX_LEN-1] = 0;
-  return printable;
-}   /* printable_diff_string() */
+  close(fds[1]);
+  slot->fd = fds[0];
+  return CUT_RESULT_PASS;
+}   /* cut_slot_fork() */
 
 /* ------------------------------------------------------------------------- */
-static int remove_tail(char* name, const char* tail)
+/**
+ * Prepares @a slot to collect the results of @a test, whose process was
+ * asked for at @a start_time.
+ */
+static void cut_slot_begin(cut_slot_t* slot, cut_test_t* test, usec_t start_time)
 {
-  const size_t name_length = strlen(name);
-  const size_t tail_length = strlen(tail);
-
-  if ((name_length > tail_length) &&
-      (0 == strcasecmp(&name[name_length - tail_length], tail)))
+  time_t stamp_time = time(NULL);
+
+  slot->test = test;
+  slot->in_len = 0;
+  slot->have_report = 0;
+  slot->have_status = 0;
+  slot->out.buffered = 1;
+  slot->out.out_len = 0;
+  slot->start_time = start_time;
+  slot->deadline = 0;
+  slot->timed_out = 0;
+  localtime_r(&stamp_time, &slot->stamp);
+
+  if (!(test->flags & CUT_TEST_FLAG_EXCLUDE) && (cut_test_timeout(test) > 0))
   {
-    name[name_length - tail_length] = 0;
-    return 1;
+    slot->deadline = slot->start_time + cut_test_timeout(test);
   }
-
-  return 0;
-}   /* remove_tail() */
+}   /* cut_slot_begin() */
 
 /* ------------------------------------------------------------------------- */
-static void shorten_name(char* name)
+/**
+ * Handles each complete frame received on @a slot.
+ */
+static void cut_slot_parse(cut_slot_t* slot)
 {
-  if (cut_shorten_names)
+  size_t used = 0;
+
+  while (slot->in_len - used >= sizeof(cut_frame_t))
   {
-    if (!remove_tail(name, "_test")) remove_tail(name, "test" );
+    cut_frame_t frame;
+    const char* payload = &slot->in[used + sizeof(frame)];
+
+    memcpy(&frame, &slot->in[used], sizeof(frame));
+
+    if (slot->in_len - used - sizeof(frame) < frame.length)
+    {
+      break;
+    }
+
+    if (CUT_FRAME_TEXT == frame.type)
+    {
+      cut_printf(&slot->out, "%.*s", (int) frame.length, payload);
+    }
+    else if ((CUT_FRAME_RESULT == frame.type) && (sizeof(slot->report) == frame.length))
+    {
+      memcpy(&slot->report, payload, sizeof(slot->report));
+      slot->have_report = 1;
+    }
+    else if ((CUT_FRAME_STATUS == frame.type) && (sizeof(int32_t) == frame.length))
+    {
+      int32_t status = 0;
+      memcpy(&status, payload, sizeof(status));
+      slot->status = status;
+      slot->have_status = 1;
+    }
+    else if ((CUT_FRAME_PID == frame.type) && (sizeof(int32_t) == frame.length))
+    {
+      int32_t pid = 0;
+      memcpy(&pid, payload, sizeof(pid));
+      slot->pid = pid;
+    }
+    else if ((CUT_FRAME_BENCHMARK == frame.type) && (NULL != g_cut->bench) && (frame.length >= sizeof(double)))
+    {
+      double* nsec = (double*) malloc(frame.length);
+
+      if (NULL != nsec)
+      {
+        memcpy(nsec, payload, frame.length);
+        cut_bench_keep(slot->test, nsec, (int) (frame.length / sizeof(double)));
+      }
+    }
+
+    used += sizeof(frame) + frame.length;
   }
-}   /* shorten_name() */
+
+  memmove(slot->in, &slot->in[used], slot->in_len - used);
+  slot->in_len -= used;
+}   /* cut_slot_parse() */
 
 /* ------------------------------------------------------------------------- */
-cut_result_t cut_install_suite(const char* name, cut_install_func_t suite_install)
+/**
+ * Reads whatever is available from the child on @a slot.
+ *
+ * @return 0 once the other end of the pipe has been closed, 1 otherwise.
+ */
+static int cut_slot_read(cut_slot_t* slot)
 {
-  cut_suite_t* suite = NULL;
-  int result = CUT_RESULT_PASS;
+  ssize_t n = 0;
 
-  assert(NULL != name);
-  assert(NULL != suite_install);
+  if (slot->in_size - slot->in_len < 0x1000)
+  {
+    size_t size = (slot->in_size > 0) ? (2 * slot->in_size) : 0x2000;
+    char* in = (char*) realloc(slot->in, size);
 
-  suite = (cut_suite_t*) malloc(sizeof(*suite));
+    if (NULL == in)
+    {
+      return 0;
+    }
 
-  if (NULL == suite)
+    slot->in = in;
+    slot->in_size = size;
+  }
+
+  n = read(slot->fd, &slot->in[slot->in_len], slot->in_size - slot->in_len);
+
+  if ((n < 0) && (EINTR == errno))
   {
-    return CUT_RESULT_FAIL;
+    return 1;
   }
 
-  memset(suite, 0, sizeof(*suite));
-  strncpy(suite->name, name, CUT_NAME_LEN_MAX);
-  suite->name[CUT_NAME_LEN_MAX-1] = 0;
-  shorten_name(suite->name);
-  g_cut->active_suite = suite;
+  if (n <= 0)
+  {
+    return 0;
+  }
+
+  slot->in_len += n;
+  cut_slot_parse(slot);
+  return 1;
+}   /* cut_slot_read() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Completes the test on @a slot once its child has exited with the wait
+ * status in slot->status: counts the result and prints the output. A child
+ * that died without reporting is counted as an ERROR, naming the signal
+ * that killed it or saying that it timed out.
+ */
+static void cut_slot_finish(cut_slot_t* slot, cut_worker_t* worker)
+{
+  cut_worker_t* out = &slot->out;
+  int status = slot->status;
+  int i = 0;
 
-  if (NULL == g_cut->suite)
+  if (slot->have_report &&
+      (slot->report.result >= CUT_RESULT_FIRST) && (slot->report.result <= CUT_RESULT_LAST))
   {
-    g_cut->suite = suite;
+    for (i = CUT_RESULT_FIRST; i <= CUT_RESULT_LAST; i++)
+    {
+      worker->assertions[i] += slot->report.assertions[i];
+    }
+
+    for (i = 0; i < CUT_PERF_PHASES * CUT_PERF_COUNT; i++)
+    {
+      worker->perf_total[i / CUT_PERF_COUNT][i % CUT_PERF_COUNT] += slot->report.perf[i / CUT_PERF_COUNT][i % CUT_PERF_COUNT];
+    }
+
+    worker->perf_have |= slot->report.perf_have;
+    worker->tests[slot->report.result]++;
+    slot->test->usec = slot->report.usec;
+    slot->test->result = (cut_result_t) slot->report.result;
+    slot->test->flags |= CUT_TEST_FLAG_TIMED | CUT_TEST_FLAG_RESULT;
   }
   else
   {
-    /*
-     * Yeah, this is inefficient. But it only happens on startup and I don't
-     * feel like implementing a doubly-linked list to maintain insertion
-     * order.
-     */
-    cut_suite_t* last = NULL;
+    char reason[0x40] = "";
+    uint64_t usec = usec_time() - slot->start_time;
+
+    slot->test->usec = usec;
+    slot->test->result = CUT_RESULT_ERROR;
+    slot->test->flags |= CUT_TEST_FLAG_TIMED | CUT_TEST_FLAG_RESULT;
+
+    if (slot->timed_out)
+    {
+      snprintf(reason, sizeof(reason), "timed out after %u.%03u s",
+               (unsigned) (usec / 1000000), (unsigned) ((usec / 1000) % 1000));
+    }
+    else if (!slot->have_status || (status < 0))
+    {
+      snprintf(reason, sizeof(reason), "could not be started");
+    }
+    else if (WIFSIGNALED(status))
+    {
+      snprintf(reason, sizeof(reason), "killed by %s", cut_signal_name(WTERMSIG(status)));
+    }
+    else if (WIFEXITED(status))
+    {
+      snprintf(reason, sizeof(reason), "exited with status %d", WEXITSTATUS(status));
+    }
+    else
+    {
+      snprintf(reason, sizeof(reason), "stopped reporting");
+    }
+
+    if ((out->out_len > 0) && ('\n' != out->out[out->out_len - 1]))
+    {
+      cut_printf(out, "\n");
+    }
+
+    worker->assertions[CUT_RESULT_ERROR]++;
+
+    if (cut_print_case_flags & CUT_FLAG_ERROR)
+    {
+      cut_printf(out, "%s%s: %-5s test process %s\n", CUT_TEST_NAME(slot->test), cut_result_name[CUT_RESULT_ERROR], reason);
+    }
+
+    cut_print_test_name(out, slot->test, &slot->stamp);
+    cut_print_result_time(out, CUT_RESULT_ERROR, usec);
+    cut_printf(out, "\n");
+    worker->tests[CUT_RESULT_ERROR]++;
+  }
+
+  fwrite(out->out, 1, out->out_len, stdout);
+  fflush(stdout);
+  out->out_len = 0;
+  slot->test = NULL;
+}   /* cut_slot_finish() */
+
+/*
+ * Forkserver. The server is forked from the process calling cut_run() once
+ * the run list is ready, and from then on does nothing but fork a child for
+ * each test it is asked to run. Each child therefore starts from the same
+ * snapshot of the warmed-up process, regardless of what the parent has done
+ * since.
+ */
+
+/**
+ * Request from the parent to the server: run g_cut->run[index] with its
+ * output going to the pipe of slot @a slot.
+ */
+typedef struct cut_request_s
+{
+  int32_t index;
+  int32_t slot;
+} cut_request_t;
+
+/**
+ * Self-pipe used by the server to notice children exiting.
+ */
+static int g_cut_sigchld_pipe[2] = { -1, -1 };
+
+/* ------------------------------------------------------------------------- */
+static void cut_forkserver_sigchld(int sig)
+{
+  int saved_errno = errno;
+  char c = (char) sig;
+  ssize_t n = write(g_cut_sigchld_pipe[1], &c, 1);
+  (void) n;
+  errno = saved_errno;
+}   /* cut_forkserver_sigchld() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Reaps the server's children, sending each exit status down the pipe of
+ * the slot the child ran on. @a runs holds the index in the run list of the
+ * test on each slot, whose suite may now be torn down.
+ *
+ * @return the number of children reaped.
+ */
+static int cut_forkserver_reap(pid_t* pids, const int* runs, const int* slot_fds, int jobs)
+{
+  int reaped = 0;
+  int status = 0;
+  pid_t pid = 0;
+
+  while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+  {
+    int i = 0;
 
-    for (last = g_cut->suite; last->next != NULL; last = last->next)
+    for (i = 0; i < jobs; i++)
     {
-        /* do nothing; finding end of list. */
+      if (pids[i] == pid)
+      {
+        int32_t wire_status = status;
+        cut_write_frame(slot_fds[i], CUT_FRAME_STATUS, &wire_status, sizeof(wire_status));
+        cut_suite_leave(&g_cut_main_worker, cut_test_suite(g_cut->run[runs[i]]));
+        pids[i] = 0;
+        reaped++;
+        break;
+      }
     }
-
-    last->next = suite;
   }
 
-  suite_install();
-  return result;
-}   /* cut_install_suite() */
+  return reaped;
+}   /* cut_forkserver_reap() */
 
 /* ------------------------------------------------------------------------- */
-cut_result_t cut_config_suite(size_t size, cut_init_func_t test_init, cut_exit_func_t test_exit)
+/**
+ * Body of the forkserver. Reads requests from @a request_fd until it is
+ * closed, then waits for any remaining children. Does not return.
+ */
+static void cut_forkserver_main(int request_fd, const int* slot_fds, int jobs)
 {
-  cut_result_t result = CUT_RESULT_PASS;
-  cut_suite_t* suite = NULL;
-  assert(NULL != g_cut);
-  assert(NULL != g_cut->active_suite);
-
-  suite = g_cut->active_suite;
+  struct sigaction action;
+  struct pollfd fds[2];
+  pid_t* pids = (pid_t*) calloc(jobs, sizeof(pids[0]));
+  int* runs = (int*) calloc(jobs, sizeof(runs[0]));
+  int running = 0;
+  int open = 1;
+  int i = 0;
 
-  if (NULL != suite->data)
+  if ((NULL == pids) || (NULL == runs) || (0 != pipe(g_cut_sigchld_pipe)))
   {
-    free(suite->data);
-    suite->data = NULL;
-    suite->size = 0;
+    _exit(1);
   }
 
-  suite->init = NULL;
-  suite->exit = NULL;
+  fcntl(g_cut_sigchld_pipe[0], F_SETFL, O_NONBLOCK);
+  fcntl(g_cut_sigchld_pipe[1], F_SETFL, O_NONBLOCK);
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = cut_forkserver_sigchld;
+  action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGCHLD, &action, NULL);
 
-  if (size > 0)
+  while (open || (running > 0))
   {
-    suite->data = malloc(size);
-
-    if (NULL == suite->data)
+    fds[0].fd = g_cut_sigchld_pipe[0];
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = request_fd;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+
+    if (poll(fds, open ? 2 : 1, -1) < 0)
     {
-      result = CUT_RESULT_FAIL;
+      if (EINTR == errno) continue;
+      break;
     }
-    else
+
+    if (fds[0].revents)
     {
-      suite->size = size;
-      suite->init = test_init;
-      suite->exit = test_exit;
+      char drain[0x40];
+      while (read(g_cut_sigchld_pipe[0], drain, sizeof(drain)) > 0)
+      {
+      }
     }
-  }
 
-  return result;
-}   /* cut_config_suite() */
+    running -= cut_forkserver_reap(pids, runs, slot_fds, jobs);
 
-/* ------------------------------------------------------------------------- */
-cut_result_t cut_add_test(const char* test_name, cut_test_func_t test_func)
-{
-  cut_result_t result = CUT_RESULT_PASS;
-  cut_test_t* test = NULL;
-  cut_suite_t* suite = NULL;
+    if (open && fds[1].revents)
+    {
+      cut_request_t request;
+      char* p = (char*) &request;
+      size_t left = sizeof(request);
 
-  assert(NULL != test_name);
-  assert(NULL != test_func);
-  assert(NULL != g_cut);
-  assert(NULL != g_cut->active_suite);
+      while (left > 0)
+      {
+        ssize_t n = read(request_fd, p, left);
 
-  suite = g_cut->active_suite;
+        if ((n < 0) && (EINTR == errno)) continue;
+        if (n <= 0) break;
+        p += n;
+        left -= n;
+      }
 
-  test = (cut_test_t*) malloc(sizeof(*test));
+      if (left > 0)
+      {
+        open = 0;
+        continue;
+      }
 
-  if (NULL == test)
-  {
-    return CUT_RESULT_FAIL;
-  }
+      if ((request.slot < 0) || (request.slot >= jobs) ||
+          (request.index < 0) || ((size_t) request.index >= g_cut->run_count))
+      {
+        continue;
+      }
 
-  memset(test, 0, sizeof(*test));
-  snprintf(test->name, CUT_NAME_LEN_MAX, "%s%s%s", suite->name, cut_name_delimiter, test_name);
-  test->name[CUT_NAME_LEN_MAX-1] = 0;
-  shorten_name(test->name);
-  test->func = test_func;
-  test->suite = suite;
+      /*
+       * Suites are set up here, so that every child forked for them starts
+       * from the set-up state.
+       */
+      cut_suite_enter(&g_cut_main_worker, cut_test_suite(g_cut->run[request.index]));
+      runs[request.slot] = request.index;
+      fflush(stdout);
+      pids[request.slot] = fork();
 
-  if (NULL == suite->test)
-  {
-    suite->test = test;
-  }
-  else
-  {
-    /*
-     * Yeah, this is inefficient. But it only happens on startup and I don't
-     * feel like implementing a doubly-linked list to maintain insertion
-     * order.
-     */
-    cut_test_t* last = NULL;
+      if (0 == pids[request.slot])
+      {
+        signal(SIGCHLD, SIG_DFL);
+        close(g_cut_sigchld_pipe[0]);
+        close(g_cut_sigchld_pipe[1]);
+        close(request_fd);
 
-    for (last = suite->test; last->next != NULL; last = last->next)
-    {
-    }
+        for (i = 0; i < jobs; i++)
+        {
+          if (i != request.slot)
+          {
+            close(slot_fds[i]);
+          }
+        }
+
+        cut_isolated_child(g_cut->run[request.index], slot_fds[request.slot]);
+      }
 
-    last->next = test;
+      if (pids[request.slot] < 0)
+      {
+        int32_t wire_status = -1;
+        pids[request.slot] = 0;
+        cut_write_frame(slot_fds[request.slot], CUT_FRAME_STATUS, &wire_status, sizeof(wire_status));
+        cut_suite_leave(&g_cut_main_worker, cut_test_suite(g_cut->run[request.index]));
+      }
+      else
+      {
+        running++;
+      }
+    }
   }
 
-  return result;
-}   /* cut_add_test() */
+  fflush(stdout);
+  _exit(0);
+}   /* cut_forkserver_main() */
 
 /* ------------------------------------------------------------------------- */
 /**
- * Processes command line arguments for cut-specific settings. If an error is
- * found in a cut-specific setting, exit() is called with error code 1 and
- * the cut-specific usage information is printed (along with any registered
- * client usage information).
+ * Starts the forkserver with one report pipe per slot. On return the server
+ * holds the write ends of the slot pipes and the caller holds the read ends
+ * (in slots[i].fd) and the write end of the request pipe.
  *
- * See cut_usage() in cut.c for the available options.
+ * @return the server's process ID, or -1 on error.
  */
-cut_result_t cut_parse_command_line(int* argc, char* argv[])
+static pid_t cut_forkserver_start(cut_slot_t* slots, int jobs, int* request_fd)
 {
+  int* slot_fds = (int*) calloc(jobs, sizeof(slot_fds[0]));
+  int request[2] = { -1, -1 };
+  pid_t pid = -1;
   int i = 0;
 
-  assert(NULL != argc);
-  assert(NULL != argv);
-
-  for (i = 1; i < *argc; i++)
+  if ((NULL == slot_fds) || (0 != pipe(request)))
   {
-    char* arg = argv[i];
-    int arg_used = 1;
+    free(slot_fds);
+    return -1;
+  }
 
-    assert(NULL != arg);
+  for (i = 0; i < jobs; i++)
+  {
+    int fds[2] = { -1, -1 };
 
-    if (*arg != '-')
+    if (0 != pipe(fds))
     {
-      continue;
+      break;
     }
 
-    if (*arg == '-') arg++;
-    if (*arg == '-') arg++;
-    if      (strcmp(arg, "show-cases"         ) == 0) cut_print_case_flags  = CUT_FLAG_ALL;
-    else if (strcmp(arg, "show-pass-cases"    ) == 0) cut_print_case_flags |= CUT_FLAG_PASS;
-    else if (strcmp(arg, "show-fail-cases"    ) == 0) cut_print_case_flags |= CUT_FLAG_FAIL;
-    else if (strcmp(arg, "show-skip-cases"    ) == 0) cut_print_case_flags |= CUT_FLAG_SKIP;
-    else if (strcmp(arg, "show-error-cases"   ) == 0) cut_print_case_flags |= CUT_FLAG_ERROR;
-    else if (strcmp(arg, "show-no-cases"      ) == 0) cut_print_case_flags  = 0;
-    else if (strcmp(arg, "no-show-cases"      ) == 0) cut_print_case_flags  = 0;
-    else if (strcmp(arg, "no-show-pass-cases" ) == 0) cut_print_case_flags &= ~CUT_FLAG_PASS;
-    else if (strcmp(arg, "no-show-fail-cases" ) == 0) cut_print_case_flags &= ~CUT_FLAG_FAIL;
-    else if (strcmp(arg, "no-show-skip-cases" ) == 0) cut_print_case_flags &= ~CUT_FLAG_SKIP;
-    else if (strcmp(arg, "no-show-error-cases") == 0) cut_print_case_flags &= ~CUT_FLAG_ERROR;
-    else if (strcmp(arg, "show-init-cases"    ) == 0) cut_print_init_cases = 1;
-    else if (strcmp(arg, "no-show-init-cases" ) == 0) cut_print_init_cases = 0;
-    else if (strcmp(arg, "show-tests"         ) == 0) cut_print_test_flags  = CUT_FLAG_ALL;
-    else if (strcmp(arg, "show-pass-tests"    ) == 0) cut_print_test_flags |= CUT_FLAG_PASS;
-    else if (strcmp(arg, "show-fail-tests"    ) == 0) cut_print_test_flags |= CUT_FLAG_FAIL;
-    else if (strcmp(arg, "show-skip-tests"    ) == 0) cut_print_test_flags |= CUT_FLAG_SKIP;
-    else if (strcmp(arg, "show-error-tests"   ) == 0) cut_print_test_flags |= CUT_FLAG_ERROR;
-    else if (strcmp(arg, "show-no-tests"      ) == 0) cut_print_test_flags  = 0;
-    else if (strcmp(arg, "no-show-tests"      ) == 0) cut_print_test_flags  = 0;
-    else if (strcmp(arg, "no-show-pass-tests" ) == 0) cut_print_test_flags &= ~CUT_FLAG_PASS;
-    else if (strcmp(arg, "no-show-fail-tests" ) == 0) cut_print_test_flags &= ~CUT_FLAG_FAIL;
-    else if (strcmp(arg, "no-show-skip-tests" ) == 0) cut_print_test_flags &= ~CUT_FLAG_SKIP;
-    else if (strcmp(arg, "no-show-error-tests") == 0) cut_print_test_flags &= ~CUT_FLAG_ERROR;
-    else
+    slots[i].fd = fds[0];
+    slot_fds[i] = fds[1];
+  }
+
+  if (i == jobs)
+  {
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+  }
+
+  if (0 == pid)
+  {
+    close(request[1]);
+
+    for (i = 0; i < jobs; i++)
     {
-      arg_used = 0;
+      close(slots[i].fd);
     }
 
-    if (arg_used)
+    cut_forkserver_main(request[0], slot_fds, jobs);
+  }
+
+  close(request[0]);
+
+  while (i-- > 0)
+  {
+    close(slot_fds[i]);
+
+    if (pid < 0)
     {
-      int j = 0;
+      close(slots[i].fd);
+    }
+  }
 
-      /*
-       * Remove argument from list.
-       */
-      for (j = i + 1; j < *argc; j++)
-      {
-        argv[j-1] = argv[j];
-      }
+  if (pid < 0)
+  {
+    close(request[1]);
+  }
 
-      (*argc)--;
-      i--;
+  *request_fd = request[1];
+  free(slot_fds);
+  return pid;
+}   /* cut_forkserver_start() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Asks the forkserver to run g_cut->run[@a index] on slot @a slot.
+ */
+static cut_result_t cut_forkserver_request(int request_fd, size_t index, int slot)
+{
+  cut_request_t request;
+
+  request.index = (int32_t) index;
+  request.slot = slot;
+
+  while (write(request_fd, &request, sizeof(request)) != (ssize_t) sizeof(request))
+  {
+    if (EINTR != errno)
+    {
+      return CUT_RESULT_ERROR;
     }
-  }   /* for each argument */
+  }
 
   return CUT_RESULT_PASS;
-}   /* cut_parse_command_line() */
+}   /* cut_forkserver_request() */
 
 /* ------------------------------------------------------------------------- */
 /**
- * Prints cut-specific usage information to the given @a file, or to stdout
- * if @a file is NULL.
+ * Runs every test in the run list in its own child process, at most @a jobs
+ * at a time. The children are forked either directly from this process or,
+ * if @a forkserver is set, from a forkserver started here. Results are
+ * counted in @a worker.
+ *
+ * @return CUT_RESULT_PASS, or CUT_RESULT_ERROR if the pool could not be
+ * created (any tests not started are then left in the run list).
  */
-void cut_usage(FILE* file)
+static cut_result_t cut_run_isolated(int jobs, int forkserver, cut_worker_t* worker)
 {
-  fprintf(
-    file,
-    "  -[no-]show-cases              Do [not] show all test assertions.\n"
-    "  -[no-]show-[type]-cases       Turn on showing of assertions for result <type>.\n"
-    "  -show-no-cases                Same as -no-show-cases; shows no assertions.\n"
-    "  -[no-]show-init-cases         Do [not] show assertions from init functions.\n"
-    "  -[no-]show-tests              Do [not] show all test results.\n"
-    "  -[no-]show-[type]-tests       Turn on showing of test results for <type>.\n"
-    "  -show-no-tests                Same as -no-show-tests; shows no test results.\n"
-    "\n"
-    "  <type> - Result types may be pass, fail, skip, or error.\n"
-    "\n"
-    );
-}   /* cut_usage() */
+  cut_result_t result = CUT_RESULT_PASS;
+  cut_slot_t* slots = NULL;
+  struct pollfd* fds = NULL;
+  int* fd_slot = NULL;
+  pid_t server = -1;
+  int request_fd = -1;
+  int active = 0;
+  usec_t start_time = 0;
+  usec_t now = 0;
+  int timeout = -1;
+  int i = 0;
 
-/* ------------------------------------------------------------------------- */
-int cut_include_test(const char* substring) {
-  int rval = 0;
+  assert(jobs > 0);
 
-  if (NULL == substring)
+  slots = (cut_slot_t*) calloc(jobs, sizeof(slots[0]));
+  fds = (struct pollfd*) calloc(jobs, sizeof(fds[0]));
+  fd_slot = (int*) calloc(jobs, sizeof(fd_slot[0]));
+
+  if ((NULL == slots) || (NULL == fds) || (NULL == fd_slot) ||
+      (forkserver && ((server = cut_forkserver_start(slots, jobs, &request_fd)) < 0)))
   {
-    return 0;
+    free(slots);
+    free(fds);
+    free(fd_slot);
+    return CUT_RESULT_ERROR;
   }
 
-  /*
-   * If this is the first time it has been called, set all the tests to be
-   * excluded.
-   */
-  if (!g_cut_info.include_test_called)
+  while ((g_cut->run_next < g_cut->run_count) || (active > 0))
   {
-    g_cut_info.include_test_called = 1;
+    int count = 0;
 
-    for (cut_suite_t* suite = g_cut_info.suite; NULL != suite; suite = suite->next)
+    /*
+     * Fill the free slots. Excluded tests do not run any code, so they are
+     * reported directly.
+     */
+    for (i = 0; (i < jobs) && (g_cut->run_next < g_cut->run_count); i++)
     {
-      for (cut_test_t* test = suite->test; NULL != test; test = test->next)
+      cut_test_t* test = g_cut->run[g_cut->run_next];
+
+      if (NULL != slots[i].test)
       {
-        test->flags |= CUT_TEST_FLAG_EXCLUDE;
+        continue;
       }
-    }
-  }
 
-  /*
-   * For each excluded test
-   */
-  for (cut_suite_t* suite = g_cut_info.suite; NULL != suite; suite = suite->next)
-  {
-    for (cut_test_t* test = suite->test; NULL != test; test = test->next)
-    {
-      if (NULL != strstr(test->name, substring))
+      if (test->flags & CUT_TEST_FLAG_EXCLUDE)
+      {
+        cut_run_test(worker, test);
+        g_cut->run_next++;
+        i--;
+        continue;
+      }
+
+      /*
+       * From a forkserver, the child's process ID arrives with its output.
+       * Children forked from here see the suite set up by this process.
+       * The clock starts before the child does, which may finish before
+       * this process gets to run again.
+       */
+      slots[i].pid = 0;
+
+      if (!forkserver)
       {
-        rval++;
-        test->flags &= ~CUT_TEST_FLAG_EXCLUDE;
+        cut_suite_enter(worker, cut_test_suite(test));
       }
+
+      start_time = usec_time();
+
+      if (forkserver ? (CUT_RESULT_PASS != cut_forkserver_request(request_fd, g_cut->run_next, i))
+                     : (CUT_RESULT_PASS != cut_slot_fork(&slots[i], slots, jobs, test)))
+      {
+        result = CUT_RESULT_ERROR;
+        break;
+      }
+
+      cut_slot_begin(&slots[i], test, start_time);
+      g_cut->run_next++;
+      active++;
     }
-  }
 
-  return rval;
-}   /* cut_include_test() */
+    if (0 == active)
+    {
+      break;
+    }
 
-/* ------------------------------------------------------------------------- */
-static cut_wrap_init_func_t g_cut_wrap_init = NULL;
-static cut_wrap_exit_func_t g_cut_wrap_exit = NULL;
-static cut_wrap_test_func_t g_cut_wrap_test = NULL;
-static void* g_cut_wrap_cookie = NULL;
+    /*
+     * Kill any test that has run past its time limit, and wake up in time
+     * for the next one to reach its limit. A forkserver child is only killed
+     * once its process ID has arrived.
+     */
+    now = usec_time();
+    timeout = -1;
 
-/* ------------------------------------------------------------------------- */
-/**
- * Sets the wrapper functions to be used when calling into a test suite. This
- * is provided so that the C++ wrapper may catch exceptions and indicate an
- * error or failure.
- */
-void cut_set_wrapper(cut_wrap_init_func_t wrap_init,
-                     cut_wrap_exit_func_t wrap_exit,
-                     cut_wrap_test_func_t wrap_test,
-                     void* wrapper_cookie)
-{
-  g_cut_wrap_init = wrap_init;
-  g_cut_wrap_exit = wrap_exit;
-  g_cut_wrap_test = wrap_test;
-  g_cut_wrap_cookie = wrapper_cookie;
-}   /* cut_set_wrapper() */
+    for (i = 0; i < jobs; i++)
+    {
+      cut_slot_t* slot = &slots[i];
 
-/* ------------------------------------------------------------------------- */
-/**
- * Registers the result of an assertion.
- * All of the other assertion functions and macros end up calling this.
- */
-cut_result_t cut_assertion_result(const char*  file,
-                                  int          line,
-                                  cut_result_t result,
-                                  const char*  message)
-{
-  assert((result >= CUT_RESULT_FIRST) && (result <= CUT_RESULT_LAST));
-  assert(NULL != g_cut);
+      if ((NULL == slot->test) || (0 == slot->deadline) || slot->timed_out)
+      {
+        continue;
+      }
 
-  /*
-   * Do not include assertions in init function.
-   */
-  if ((NULL != g_cut->active_test) || cut_print_init_cases)
-  {
-    g_cut->assertions[result]++;
+      if (now >= slot->deadline)
+      {
+        if (slot->pid > 0)
+        {
+          kill(slot->pid, SIGKILL);
+          slot->timed_out = 1;
+        }
+      }
+      else if ((timeout < 0) || ((slot->deadline - now + 999) / 1000 < (usec_t) timeout))
+      {
+        timeout = (int) ((slot->deadline - now + 999) / 1000);
+      }
+    }
 
-    if (cut_print_case_flags & CUT_RESULT_FLAG(result))
+    for (i = 0; i < jobs; i++)
     {
-      if (g_cut->test_name_hanging)
+      if (NULL != slots[i].test)
       {
-        printf("\n");
-        g_cut->test_name_hanging = 0;
+        fds[count].fd = slots[i].fd;
+        fds[count].events = POLLIN;
+        fds[count].revents = 0;
+        fd_slot[count] = i;
+        count++;
       }
+    }
 
-      printf("%s:%d: %-5s %s\n", file, line, cut_result_name[result], message);
+    if (poll(fds, count, timeout) < 0)
+    {
+      if (EINTR == errno) continue;
+      result = CUT_RESULT_ERROR;
+      break;
     }
-  }
 
-  return result;
-}   /* cut_assertion_result() */
+    for (i = 0; i < count; i++)
+    {
+      cut_slot_t* slot = &slots[fd_slot[i]];
+      int open = 1;
 
-/* ------------------------------------------------------------------------- */
-/**
- * Makes an assertion for the currently running test or test_init() function.
- * All of the other assertion functions and macros end up calling this.
- */
-cut_result_t cut_assert(const char* file,
-                        int         line,
-                        int         condition,
-                        const char* message)
-{
-  cut_result_t result = CUT_RESULT_PASS;
+      if (0 == fds[i].revents)
+      {
+        continue;
+      }
 
-  assert(NULL != g_cut);
-  assert(NULL != g_cut->active_suite);
+      open = cut_slot_read(slot);
 
-  if (!condition)
-  {
-    result = (NULL != g_cut->active_test) ? CUT_RESULT_FAIL : CUT_RESULT_ERROR;
-  }
+      if (!forkserver && !open)
+      {
+        /*
+         * The child has exited (or at least closed its end).
+         */
+        int status = 0;
 
-  return cut_assertion_result(file, line, result, message);
-}   /* cut_assert() */
+        close(slot->fd);
 
-/* ------------------------------------------------------------------------- */
-cut_result_t cut_assertf(const char* file,
-                         int         line,
-                         int         condition,
-                         const char* format,
-                         ...)
-{
-  char message[0x100] = "";
-  va_list va;
-  va_start(va, format);
-  vsnprintf(message, sizeof(message), format, va);
-  va_end(va);
-  message[sizeof(message) - 1] = 0;
-  return cut_assert(file, line, condition, message);
-}   /* cut_assertf() */
+        while ((waitpid(slot->pid, &status, 0) < 0) && (EINTR == errno))
+        {
+        }
 
-/**
- * String used to separate the actual value from any extra message.
- */
-#define CUT_EXTRA_MESSAGE_PAD   " - "
+        slot->status = status;
+        slot->have_status = 1;
+      }
 
-/* ------------------------------------------------------------------------- */
-cut_result_t cut_assert_pointer(const char* file, int line, const void* proper, const void* actual,
-                                const char* extra_message)
-{
-  return cut_assertf(file, line, proper == actual, "\n  Proper: @%p\n  Actual: @%p%s%s", proper, actual,
-                     (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                     (extra_message == NULL) ? "" : extra_message);
-}   /* cut_assert_pointer() */
+      if (slot->have_status || !open)
+      {
+        cut_suite_t* suite = cut_test_suite(slot->test);
 
-/* ------------------------------------------------------------------------- */
-/**
- * If @a lo greater than @a hi, swap them.
- */
-#define CHECK_LO_HI(_type,_lo,_hi) \
-  do {                             \
-    if (_hi < _lo) {               \
-      _type _temp = _lo;           \
-      _lo = _hi;                   \
-      _hi = _temp;                 \
-    }                              \
-  } while (0)
+        cut_slot_finish(slot, worker);
+        active--;
 
-/* ------------------------------------------------------------------------- */
-cut_result_t cut_assert_int_in(const char* file, int line, long long proper_lo, long long proper_hi, long long actual,
-                               const char* extra_message)
-{
-  const char* comparison_text = (actual < proper_lo) ? " (< Lower)" : ((actual > proper_hi) ? " (> Upper)" : "");
-#define MINGW 0
-#if defined(MINGW)
-  if (proper_lo == proper_hi)
-  {
-    return cut_assertf(file, line, proper_lo == actual,
-                       "\n  Proper: %10ld (0x%08lX)\n  Actual: %10ld (0x%08lX)",
-                       (long) proper_lo, (long) proper_lo, (long) actual, (long) actual,
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message);
-  }
-  else
-  {
-    CHECK_LO_HI(long long, proper_lo, proper_hi);
-    return cut_assertf(file, line, (proper_lo <= actual) && (actual <= proper_hi),
-                       "\n  Lower:  %10ld (0x%08lX)\n  Actual: %10ld (0x%08lX)%s%s%s\n  Upper:  %10ld (0x%08lX)",
-                       (long) proper_lo, (long) proper_lo,
-                       (long) actual, (long) actual, comparison_text,
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message,
-                       (long) proper_hi, (long) proper_hi);
-  }
-#else
-  if (proper_lo == proper_hi)
-  {
-    return cut_assertf(file, line, proper_lo == actual,
-                       "\n  Proper: %10lld (0x%08llX)\n  Actual: %10lld (0x%08llX)%s%s",
-                       proper_lo, proper_lo, actual, actual,
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message);
-  }
-  else
-  {
-    CHECK_LO_HI(long long, proper_lo, proper_hi);
-    return cut_assertf(file, line, (proper_lo <= actual) && (actual <= proper_hi),
-                       "\n  Lower:  %10lld (0x%08llX)\n  Actual: %10lld (0x%08llX)%s%s%s\n  Upper:  %10lld (0x%08llX)",
-                       proper_lo, proper_lo, actual, actual, comparison_text,
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message,
-                       proper_hi, proper_hi);
-  }
-#endif
-}   /* cut_assert_int_in() */
+        if (!forkserver)
+        {
+          cut_suite_leave(worker, suite);
+        }
+      }
 
-/* ------------------------------------------------------------------------- */
-cut_result_t cut_assert_double_in(const char* file, int line, double proper_lo, double proper_hi, double actual,
-                                  const char* extra_message)
-{
-  if (proper_lo == proper_hi)
-  {
-    return cut_assertf(file, line, proper_lo == actual,
-                       "\n  Proper: %18.15E (%g)\n  Actual: %18.15E (%g)%s%s",
-                       proper_lo, proper_lo, actual, actual,
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message);
+      if (forkserver && !open)
+      {
+        fprintf(stderr, "cut: forkserver exited unexpectedly\n");
+        result = CUT_RESULT_ERROR;
+      }
+    }
+
+    if (CUT_RESULT_PASS != result)
+    {
+      break;
+    }
   }
-  else
+
+  if (forkserver)
   {
-    CHECK_LO_HI(double, proper_lo, proper_hi);
-    const char* comparison_text = (actual < proper_lo) ? " (< Lower)" : ((proper_hi < actual) ? " (> Upper)" : "");
-    return cut_assertf(file, line, (proper_lo <= actual) && (actual <= proper_hi),
-                       "\n  Lower:  %18.15E (%g)\n  Actual: %18.15E (%g)%s%s%s\n  Upper:  %18.15E (%g)",
-                       proper_lo, proper_lo, actual, actual, comparison_text,
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message,
-                       proper_hi, proper_hi);
+    close(request_fd);
   }
-}   /* cut_assert_double_in() */
-
-/* ------------------------------------------------------------------------- */
-cut_result_t cut_assert_string(const char* file, int line, const char* proper, const char* actual,
-                               const char* extra_message)
-{
-  size_t plen = 0;
-  size_t alen = 0;
-  size_t max_len = 0;
-  size_t i = 0;
 
   /*
-   * Handle the NULL cases first.
+   * Only reached with tests still running if something went wrong; let them
+   * finish so that nothing is left behind.
    */
-  if ((NULL == proper) && (NULL == actual))
-  {
-    return cut_assertf(file, line, 1, "\n  Proper: NULL\n  Actual: NULL%s%s",
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message);
-  }
-  else if (NULL == proper)
-  {
-    return cut_assertf(file, line, 0, "\n  Proper: NULL\n  Actual: non-NULL%s%s",
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message);
-  }
-  else if (NULL == actual)
+  for (i = 0; i < jobs; i++)
   {
-    return cut_assertf(file, line, 0, "\n  Proper: non-NULL\n  Actual: NULL%s%s",
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message);
-  }
+    if (NULL != slots[i].test)
+    {
+      cut_suite_t* suite = cut_test_suite(slots[i].test);
 
-  plen = strlen(proper);
-  alen = strlen(actual);
+      while (cut_slot_read(&slots[i]) && !slots[i].have_status)
+      {
+      }
 
-  /*
-   * Eventually I need to do the pretty string slice printing, but for now I
-   * just run the memory comparison, being careful to check up to the
-   * readable portion of either.
-   */
-/*   if (alen < plen) */
-/*   { */
-/*     return cut_assert_memory(file, line, proper, actual, alen + 1); */
-/*   } */
+      if (!forkserver)
+      {
+        close(slots[i].fd);
+        waitpid(slots[i].pid, &slots[i].status, 0);
+        slots[i].have_status = 1;
+      }
 
-/*   return cut_assert_memory(file, line, proper, actual, plen); */
+      cut_slot_finish(&slots[i], worker);
 
-  max_len = plen > alen ? plen : alen;
-  max_len++;   /* Include terminating NUL. */
+      if (!forkserver)
+      {
+        cut_suite_leave(worker, suite);
+      }
+    }
 
-  for (i = 0; i < max_len; i++)
-  {
-    if (proper[i] != actual[i])
+    if (forkserver)
     {
-      char pcimg[CHAR_IMAGE_MAX_LEN] = "";
-      char acimg[CHAR_IMAGE_MAX_LEN] = "";
-      char pdiff[PRINTABLE_DIFF_STRING_MAX_LEN] = "";
-      char adiff[PRINTABLE_DIFF_STRING_MAX_LEN] = "";
+      close(slots[i].fd);
+    }
 
-      return cut_assertf(file, line, 0,
-                         "\n  Proper at [%d]: 0x%02X %3d %-6s \"%s\"\n  Actual at [%d]: 0x%02X %3d %-6s \"%s\"%s%s",
-                         (int) i, (unsigned) proper[i], (unsigned) proper[i], char_image(proper[i], pcimg),
-                         printable_diff_string(pdiff, proper, plen, i),
-                         (int) i, (unsigned) actual[i], (unsigned) actual[i], char_image(actual[i], acimg),
-                         printable_diff_string(adiff, actual, alen, i),
-                         (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                         (extra_message == NULL) ? "" : extra_message);
+    free(slots[i].in);
+    free(slots[i].out.out);
+  }
+
+  if (server > 0)
+  {
+    while ((waitpid(server, NULL, 0) < 0) && (EINTR == errno))
+    {
     }
   }
 
-  return cut_assertf(file, line, 1, "strings of length %d (0x%02X) match%s%s", (int) plen, (int) plen,
-                     (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                     (extra_message == NULL) ? "" : extra_message);
-}   /* cut_assert_string() */
+  free(slots);
+  free(fds);
+  free(fd_slot);
+  return result;
+}   /* cut_run_isolated() */
+#endif
 
 /* ------------------------------------------------------------------------- */
-cut_result_t cut_assert_memory(const char* file, int line, const void* proper, const void* actual, size_t n,
-                               const char* extra_message)
+/**
+ * Orders site counts by suite and test, then by site, so that counts for
+ * the same site are next to each other.
+ */
+static int cut_compare_site(const void* a, const void* b)
 {
-  size_t i = 0;
-  const unsigned char* p = (const unsigned char*) proper;
-  const unsigned char* a = (const unsigned char*) actual;
-
-  /*
-   * Handle the NULL cases first.
-   */
-  if ((NULL == proper) && (NULL == actual))
-  {
-    return cut_assertf(file, line, 1, "\n  Proper: NULL\n  Actual: NULL%s%s",
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message);
-  }
-  else if (NULL == proper)
-  {
-    return cut_assertf(file, line, 0, "\n  Proper: NULL\n  Actual: non-NULL%s%s",
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message);
+  const cut_site_count_t* sa = *(const cut_site_count_t* const*) a;
+  const cut_site_count_t* sb = *(const cut_site_count_t* const*) b;
+  int rval = 0;
+
+  if (sa->test->suite != sb->test->suite)
+  {
+    return (sa->test->suite < sb->test->suite) ? -1 : 1;
   }
-  else if (NULL == actual)
+
+  if (sa->test != sb->test)
   {
-    return cut_assertf(file, line, 0, "\n  Proper: non-NULL\n  Actual: NULL%s%s",
-                       (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                       (extra_message == NULL) ? "" : extra_message);
+    return (sa->test < sb->test) ? -1 : 1;
   }
 
-  for (i = 0; i < n; i++)
+  if ((sa->file != sb->file) && (0 != (rval = strcmp(sa->file, sb->file))))
   {
-    if (p[i] != a[i])
-    {
-      char pcimg[CHAR_IMAGE_MAX_LEN] = "";
-      char acimg[CHAR_IMAGE_MAX_LEN] = "";
+    return rval;
+  }
 
-      return cut_assertf(file, line, 0,
-                         "\n  Proper at [%d]: 0x%02X (%d, %s)\n  Actual at [%d]: 0x%02X (%d, %s)%s%s",
-                         (int) i, p[i], p[i], char_image(p[i], pcimg),
-                         (int) i, a[i], a[i], char_image(a[i], acimg),
-                         (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                         (extra_message == NULL) ? "" : extra_message);
-    }
+  return (sa->line > sb->line) - (sa->line < sb->line);
+}   /* cut_compare_site() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the total number of assertions counted for @a site.
+ */
+static unsigned int cut_site_total(const cut_site_count_t* site)
+{
+  unsigned int total = 0;
+  int r = 0;
+
+  for (r = CUT_RESULT_FIRST; r <= CUT_RESULT_LAST; r++)
+  {
+    total += site->count[r];
   }
 
-  return cut_assertf(file, line, 1, "buffers of length %d (0x%02X) match%s%s", (int) n, (int) n,
-                     (extra_message == NULL) ? "" : CUT_EXTRA_MESSAGE_PAD,
-                     (extra_message == NULL) ? "" : extra_message);
-}   /* cut_assert_memory() */
+  return total;
+}   /* cut_site_total() */
 
 /* ------------------------------------------------------------------------- */
-void cut_print_summary(FILE* file, cut_result_t result)
+/**
+ * @return the fraction of the assertions at @a site that failed or erred.
+ */
+static double cut_site_fail_rate(const cut_site_count_t* site)
 {
-  size_t total_assertions = 0;
-  size_t total_tests = 0;
-  int i = 0;
+  unsigned int total = cut_site_total(site);
 
-  assert(NULL != file);
-  assert((CUT_RESULT_FIRST <= result) && (result <= CUT_RESULT_LAST));
+  return (total > 0) ? (double) (site->count[CUT_RESULT_FAIL] + site->count[CUT_RESULT_ERROR]) / total : 0.0;
+}   /* cut_site_fail_rate() */
 
-  fprintf(file, "%12s", "");
+/* ------------------------------------------------------------------------- */
+/**
+ * Orders site counts busiest first, then by site.
+ */
+static int cut_compare_site_count(const void* a, const void* b)
+{
+  const cut_site_count_t* sa = *(const cut_site_count_t* const*) a;
+  const cut_site_count_t* sb = *(const cut_site_count_t* const*) b;
+  unsigned int ta = cut_site_total(sa);
+  unsigned int tb = cut_site_total(sb);
 
-  for (i = CUT_RESULT_FIRST; i <= CUT_RESULT_LAST; i++)
+  if (ta != tb)
   {
-    fprintf(file, " %7s", cut_result_name[i]);
+    return (ta > tb) ? -1 : 1;
   }
 
-  fprintf(file, " %8s", "Total");
-  fprintf(file, "\n");
+  return cut_compare_site(a, b);
+}   /* cut_compare_site_count() */
 
-  fprintf(file, "%-12s", "Assertions");
+/* ------------------------------------------------------------------------- */
+/**
+ * Orders site counts by failure rate, highest first, then busiest first.
+ */
+static int cut_compare_site_failures(const void* a, const void* b)
+{
+  double ra = cut_site_fail_rate(*(const cut_site_count_t* const*) a);
+  double rb = cut_site_fail_rate(*(const cut_site_count_t* const*) b);
 
-  for (i = CUT_RESULT_FIRST; i <= CUT_RESULT_LAST; i++)
+  if (ra != rb)
   {
-    total_assertions += g_cut->assertions[i];
-    fprintf(file, " %7d", g_cut->assertions[i]);
+    return (ra > rb) ? -1 : 1;
   }
 
-  fprintf(file, " %8d\n", (int) total_assertions);
+  return cut_compare_site_count(a, b);
+}   /* cut_compare_site_failures() */
 
-  fprintf(file, "%-12s", "Tests");
+/* ------------------------------------------------------------------------- */
+/**
+ * Prints up to CUT_PROFILE_TOP of the @a count @a sites to @a file, under
+ * @a title.
+ */
+static void cut_print_sites(FILE* file, const char* title, cut_site_count_t** sites, size_t count)
+{
+  size_t i = 0;
 
-  for (i = CUT_RESULT_FIRST; i <= CUT_RESULT_LAST; i++)
+  fprintf(file, "  %s:\n", title);
+
+  for (i = 0; (i < count) && (i < CUT_PROFILE_TOP); i++)
   {
-    total_tests += g_cut->tests[i];
-    fprintf(file, " %7d", g_cut->tests[i]);
-  }
+    const cut_site_count_t* site = sites[i];
 
-  fprintf(file, " %8d\n", (int) total_tests);
-  fprintf(file, "Result: %s\n", cut_result_name[result]);
-}   /* cut_print_summary() */
+    fprintf(file, "    %10u %8u %6.1f%% %12llu us  %s:%d\n", cut_site_total(site),
+            site->count[CUT_RESULT_FAIL] + site->count[CUT_RESULT_ERROR], 100.0 * cut_site_fail_rate(site),
+            (unsigned long long) site->usec, site->file, site->line);
+  }
+}   /* cut_print_sites() */
 
 /* ------------------------------------------------------------------------- */
-static void cut_print_test_name(const char* name, struct tm* stamp)
+/**
+ * Prints the assertion profile gathered in g_cut->sites to @a file: for each
+ * test, its busiest sites and, if any failed, its most failing sites.
+ */
+static void cut_print_assertion_profile(FILE* file)
 {
+  cut_site_count_t** sites = NULL;
+  size_t count = 0;
+  size_t first = 0;
   size_t i = 0;
+  int r = 0;
 
-  assert(g_cut);
-  assert(name);
-  assert(stamp);
+  if (0 == g_cut->sites.count)
+  {
+    fprintf(file, "\nNo assertions were profiled.\n");
+    return;
+  }
 
-  printf("%02u:%02u:%02u %s ", stamp->tm_hour, stamp->tm_min, stamp->tm_sec, name);
-  for (i = strlen(name); i < 50; i++) printf(".");
-  printf(" ");
-  g_cut->test_name_hanging = 1;
-  fflush(stdout);
-}   /* cut_print_test_name() */
+  sites = (cut_site_count_t**) malloc(g_cut->sites.count * sizeof(*sites));
+
+  if (NULL == sites)
+  {
+    fprintf(stderr, "cut: out of memory printing the assertion profile\n");
+    return;
+  }
+
+  for (i = 0; i < g_cut->sites.size; i++)
+  {
+    if (NULL != g_cut->sites.slot[i].file)
+    {
+      sites[count++] = &g_cut->sites.slot[i];
+    }
+  }
+
+  /*
+   * Combine the counts of sites whose file names were at different
+   * addresses.
+   */
+  qsort(sites, count, sizeof(*sites), cut_compare_site);
+
+  for (first = 0, i = 1; i < count; i++)
+  {
+    if (0 == cut_compare_site(&sites[first], &sites[i]))
+    {
+      for (r = CUT_RESULT_FIRST; r <= CUT_RESULT_LAST; r++)
+      {
+        sites[first]->count[r] += sites[i]->count[r];
+      }
+
+      sites[first]->usec += sites[i]->usec;
+    }
+    else
+    {
+      sites[++first] = sites[i];
+    }
+  }
+
+  count = (count > 0) ? first + 1 : 0;
+  fprintf(file, "\nAssertion profile (count, failures, failure rate, time, site):\n");
+
+  for (first = 0; first < count; first = i)
+  {
+    size_t failing = 0;
+
+    for (i = first; (i < count) && (sites[i]->test == sites[first]->test); i++)
+    {
+      failing += (cut_site_fail_rate(sites[i]) > 0.0);
+    }
+
+    fprintf(file, "%s%s\n", CUT_TEST_NAME(sites[first]->test));
+    qsort(&sites[first], i - first, sizeof(*sites), cut_compare_site_count);
+    cut_print_sites(file, "busiest", &sites[first], i - first);
+
+    if (failing > 0)
+    {
+      qsort(&sites[first], i - first, sizeof(*sites), cut_compare_site_failures);
+      cut_print_sites(file, "most failing", &sites[first], failing);
+    }
+  }
+
+  free(sites);
+}   /* cut_print_assertion_profile() */
 
 /* ------------------------------------------------------------------------- */
 /**
- * Run the entire suite - all tests that are currently enabled.
- *
- * @param print_summary - if non-zero, a summary will be printed to stdout.
- *
- * @return a cut_result_t code, the first of each of these conditions:
- * - CUT_RESULT_ERROR if any of the tests reported an error condition.
- * - CUT_RESULT_FAIL if any of the tests reported a failure.
- * - CUT_RESULT_SKIP if *all* of the tests were skipped.
- * - CUT_RESULT_PASS if at least one test passed and there were no errors or
- * failures.
+ * Run the entire suite - all tests that are currently enabled - on @a jobs
+ * threads. See cut_run().
  */
-cut_result_t cut_run(int print_summary)
+cut_result_t cut_run_parallel(int print_summary, int jobs)
 {
   cut_result_t run_result = CUT_RESULT_PASS;
-  cut_suite_t* suite = NULL;
+  cut_worker_t* worker = &g_cut_main_worker;
+  int isolate = cut_isolate || cut_forkserver;
 
   assert(g_cut != NULL);
 
+#if defined(_WIN32)
+  if (isolate)
+  {
+    fprintf(stderr, "cut: test isolation is not supported on this platform\n");
+    isolate = 0;
+  }
+#endif
+
+  if (CUT_RESULT_PASS != cut_install_static_tests())
+  {
+    fprintf(stderr, "cut: out of memory installing tests\n");
+    return CUT_RESULT_ERROR;
+  }
+
+  /*
+   * Suites still pending after tests were included hold none of them, so
+   * their installers are never called.
+   */
+  if (!g_cut->include_test_called)
+  {
+    cut_install_pending(NULL, 0);
+  }
+
   memset(g_cut->assertions, 0, sizeof(g_cut->assertions));
   memset(g_cut->tests,      0, sizeof(g_cut->tests));
+  g_cut->print_summary = print_summary;
+  memset(g_cut->perf_total, 0, sizeof(g_cut->perf_total));
+  g_cut->perf_have = 0;
+  memset(worker->assertions, 0, sizeof(worker->assertions));
+  memset(worker->tests,      0, sizeof(worker->tests));
+  memset(worker->done_assertions, 0, sizeof(worker->done_assertions));
+  memset(worker->done_tests,      0, sizeof(worker->done_tests));
 
-  for (suite = g_cut->suite; suite != NULL; suite = suite->next)
+  /*
+   * The results of the last run are kept in the history file.
+   */
+  if ((cut_failed_first || cut_failed_only) && (NULL == cut_history_file))
   {
-    cut_test_t* test = NULL;
+    cut_history_file = cut_default_history_file();
+  }
 
-    g_cut->active_suite = suite;
+  if (g_cut->exclude_count > 0)
+  {
+    int* matched = (int*) calloc(g_cut->exclude_count, sizeof(int));
+    size_t i = 0;
 
-    for (test = suite->test; test != NULL; test = test->next)
+    if ((NULL == matched) || (CUT_RESULT_ERROR == cut_select(g_cut->exclude, g_cut->exclude_count, 1, matched)))
     {
-      usec_t       start_time = 0;
-      uint64_t     usec = 0;
-      time_t       stamp_time;
-      struct tm    stamp;
-      cut_result_t result = CUT_RESULT_PASS;
-      int          exclude_test = 0;
-
-      assert(test);
-      assert(test->name);
-
-      exclude_test = (test->flags & CUT_TEST_FLAG_EXCLUDE) != 0;
+      fprintf(stderr, "cut: out of memory applying -exclude\n");
+      free(matched);
+      return CUT_RESULT_ERROR;
+    }
 
-      if (suite->data)
+    for (i = 0; i < g_cut->exclude_count; i++)
+    {
+      if (0 == matched[i])
       {
-        memset(suite->data, 0, suite->size);
+        fprintf(stderr, "cut: no test names match -exclude '%s'\n", g_cut->exclude[i]);
       }
+    }
 
-      stamp_time = time(NULL);
-#if defined(_WIN32)
-      localtime_s(&stamp, &stamp_time);
-#elif defined(MINGW)
-      stamp = *localtime(&stamp_time);
-#else
-      localtime_r(&stamp_time, &stamp);
-#endif
-      cut_print_test_name(test->name, &stamp);
+    free(matched);
+  }
 
-      start_time = usec_time();
+  cut_history_load();
 
-      if (suite->init && !exclude_test)
-      {
-        if (NULL != g_cut_wrap_init)
-        {
-          result = g_cut_wrap_init(suite->init, suite->data, g_cut_wrap_cookie);
-        }
-        else
-        {
-          result = suite->init(suite->data);
-        }
-      }
+  if (cut_track_allocations && !CUT_ALLOC_HOOKS)
+  {
+    fprintf(stderr, "cut: -track-allocations needs cut.c built with CUT_ALLOC_HOOKS defined as 1\n");
+  }
 
-      /*
-       * Only run test if init() succeeded.
-       */
-      if (CUT_RESULT_PASS == result)
-      {
-        if ((NULL == test->func) || exclude_test)
-        {
-          result = CUT_RESULT_SKIP;
-        }
-        else
-        {
-          g_cut->active_test = test;
+  if (CUT_RESULT_PASS != cut_bench_load())
+  {
+    fprintf(stderr, "cut: out of memory reading benchmark runs\n");
+    return CUT_RESULT_ERROR;
+  }
 
-          if (NULL != g_cut_wrap_test)
-          {
-            result = g_cut_wrap_test(test->func, suite->data, g_cut_wrap_cookie);
-          }
-          else
-          {
-            result = test->func(suite->data);
-          }
+  if (cut_failed_only)
+  {
+    cut_select_failed();
+  }
 
-          g_cut->active_test = NULL;
-        }
-      }
+  cut_assign_shards();
 
-      if ((result < CUT_RESULT_FIRST) ||
-          (result > CUT_RESULT_LAST))
-      {
-        result = CUT_RESULT_ERROR;
-      }
+  if (CUT_RESULT_PASS != cut_build_run_list())
+  {
+    fprintf(stderr, "cut: out of memory building the list of tests\n");
+    return CUT_RESULT_ERROR;
+  }
 
-      g_cut->tests[result]++;
+  if (jobs <= 0)
+  {
+    jobs = cut_cpu_count();
+  }
 
-      /*
-       * Always run the finalization function if it exists.
-       */
-      if (suite->exit && !exclude_test)
-      {
-        if (NULL != g_cut_wrap_exit)
-        {
-          g_cut_wrap_exit(suite->exit, suite->data, g_cut_wrap_cookie);
-        }
-        else
-        {
-          suite->exit(suite->data);
-        }
-      }
+  if ((size_t) jobs > g_cut->run_count)
+  {
+    jobs = (int) g_cut->run_count;
+  }
 
-      /*
-       * If the test name was removed due to an assertion being printed, put
-       * it back.
-       */
-      if (!g_cut->test_name_hanging)
-      {
-        cut_print_test_name(test->name, &stamp);
-      }
+  /*
+   * Workers take the next test from the shared list as they become idle, so
+   * starting with the longest tests keeps the last worker from finishing
+   * long after the others.
+   */
+  if (jobs > 1)
+  {
+    cut_schedule_run_list();
+  }
 
-      usec = usec_time() - start_time;
-      printf("%-5s %02u:%02u.%06u\n", cut_result_name[result],
-             (int) (usec / (60 * 1000000)), (int) ((usec / 1000000) % 60), (int) (usec % 1000000));
-      g_cut->test_name_hanging = 0;
-    }   /* for each test in the suite */
-  }   /* for each suite */
+  if (cut_failed_first)
+  {
+    cut_run_failed_first();
+  }
+
+  /*
+   * usec_time() sets its origin on the first call, which must not race
+   * between worker threads.
+   */
+  (void) usec_time();
+
+  if (cut_perf_counters)
+  {
+    cut_perf_probe();
+  }
+
+  cut_count_suite_tests();
+  cut_mutex_init(&g_cut->lock);
+  cut_mutex_init(&g_cut->suite_lock);
+
+  if (isolate)
+  {
+#if !defined(_WIN32)
+    if (CUT_RESULT_PASS != cut_run_isolated((jobs > 0) ? jobs : 1, cut_forkserver, worker))
+    {
+      fprintf(stderr, "cut: could not start all test processes\n");
+    }
+#endif
+  }
+  else
+  {
+    cut_watchdog_start();
+
+    if ((jobs > 1) && (CUT_RESULT_PASS != cut_run_threads(jobs)))
+    {
+      fprintf(stderr, "cut: could not start all worker threads\n");
+    }
+  }
+
+  /*
+   * Serial run, or whatever the threads left behind.
+   */
+  for (; g_cut->run_next < g_cut->run_count; g_cut->run_next++)
+  {
+    cut_run_test(worker, g_cut->run[g_cut->run_next]);
+  }
+
+  cut_watchdog_stop();
+  cut_mutex_destroy(&g_cut->lock);
+  cut_mutex_destroy(&g_cut->suite_lock);
+  cut_release_suites();
+  cut_merge_worker(worker);
+  cut_perf_close(worker);
+  cut_history_save();
+  cut_bench_save();
+
+  if (cut_profile_assertions)
+  {
+    if (isolate)
+    {
+      fprintf(stderr, "cut: -profile-assertions does not see tests run in their own processes\n");
+    }
+
+    cut_print_assertion_profile(stdout);
+    free(g_cut->sites.slot);
+    memset(&g_cut->sites, 0, sizeof(g_cut->sites));
+  }
 
   if (g_cut->tests[CUT_RESULT_ERROR] > 0)
   {
@@ -1217,4 +8590,22 @@ cut_result_t cut_run(int print_summary)
   }
 
   return run_result;
+}   /* cut_run_parallel() */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Run the entire suite - all tests that are currently enabled.
+ *
+ * @param print_summary - if non-zero, a summary will be printed to stdout.
+ *
+ * @return a cut_result_t code, the first of each of these conditions:
+ * - CUT_RESULT_ERROR if any of the tests reported an error condition.
+ * - CUT_RESULT_FAIL if any of the tests reported a failure.
+ * - CUT_RESULT_SKIP if *all* of the tests were skipped.
+ * - CUT_RESULT_PASS if at least one test passed and there were no errors or
+ * failures.
+ */
+cut_result_t cut_run(int print_summary)
+{
+  return cut_run_parallel(print_summary, cut_jobs);
 }   /* cut_run() */
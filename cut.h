@@ -69,10 +69,17 @@ typedef void         (*cut_install_func_t)(void);
 typedef cut_result_t (*cut_init_func_t)(void* data);
 typedef void         (*cut_exit_func_t)(void* data);
 typedef cut_result_t (*cut_test_func_t)(void* data);
+typedef cut_result_t (*cut_benchmark_func_t)(void* data, size_t iterations);
 
 cut_result_t cut_install_suite(const char* name, cut_install_func_t suite_install);
 cut_result_t cut_config_suite(size_t size, cut_init_func_t test_init, cut_exit_func_t test_exit);
+cut_result_t cut_config_suite_snapshot(size_t size, cut_init_func_t test_init, cut_exit_func_t test_exit);
+cut_result_t cut_config_suite_once(size_t size, cut_init_func_t suite_setup, cut_exit_func_t suite_teardown);
 cut_result_t cut_add_test(const char* test_name, cut_test_func_t test_func);
+cut_result_t cut_config_timeout(unsigned timeout_msec);
+cut_result_t cut_add_test_timeout(const char* test_name, cut_test_func_t test_func, unsigned timeout_msec);
+cut_result_t cut_add_benchmark(const char* benchmark_name, cut_benchmark_func_t benchmark_func);
+cut_result_t cut_add_scaling_benchmark(const char* benchmark_name, cut_benchmark_func_t benchmark_func);
 
 /**
  * In your main test program (that is, not a particular test suite), use this
@@ -82,6 +89,14 @@ cut_result_t cut_add_test(const char* test_name, cut_test_func_t test_func);
  *
  * _name() should optionally use CUT_CONFIG_SUITE() and then a sequence of
  * CUT_ADD_TEST() to add each of the suite's tests.
+ *
+ * The installer is not called right away. It is called when tests are
+ * selected with cut_include_test() or cut_select_tests(), but only if the
+ * suite might hold a selected test, or by cut_run() if no tests were
+ * selected. So a run of a few tests doesn't pay for installing and
+ * allocating every suite. To tell from the suite's name alone, a pattern
+ * containing cut_name_delimiter is taken to name the suite before it, as in
+ * "suite.test", since the tests' own names don't contain it.
  */
 #define CUT_INSTALL_SUITE(_name)       \
   do {                                 \
@@ -103,12 +118,208 @@ cut_result_t cut_add_test(const char* test_name, cut_test_func_t test_func);
  */
 #define CUT_CONFIG_SUITE(_size,_init,_exit) cut_config_suite(_size, (cut_init_func_t) _init, (cut_exit_func_t) _exit)
 
+/**
+ * As CUT_CONFIG_SUITE(), but for suites whose data buffer holds plain old
+ * data. @a _init() runs only once, on a zeroed buffer, before the suite's
+ * first selected test. Each test then starts with a copy of that buffer
+ * instead of a zeroed buffer passed through @a _init(). @a _exit() runs
+ * once, on the original, after the suite's last test.
+ *
+ * The tests must not rely on anything outside the buffer that @a _init()
+ * would have set up, and the buffer must not hold pointers into itself.
+ */
+#define CUT_CONFIG_SUITE_SNAPSHOT(_size,_init,_exit) \
+  cut_config_suite_snapshot(_size, (cut_init_func_t) _init, (cut_exit_func_t) _exit)
+
+/**
+ * Should be used in the test suite's installer function (see
+ * CUT_INSTALL_SUITE()) for work that is too expensive to repeat for every
+ * test, such as opening a database or parsing a large fixture file.
+ *
+ * A data buffer of @a _size bytes is allocated and zeroed, then passed to
+ * @a _setup() once before the first of the suite's selected tests runs, and
+ * to @a _teardown() once after the last of them finishes. The tests and
+ * their init and exit functions find the buffer with cut_suite_data(). If
+ * @a _setup() does not return CUT_RESULT_PASS, each of the suite's tests is
+ * reported as an ERROR without being run.
+ *
+ * Tests of the suite that run in parallel share the buffer, so they should
+ * only read it. Isolated tests each see a copy of it.
+ */
+#define CUT_CONFIG_SUITE_ONCE(_size,_setup,_teardown) \
+  cut_config_suite_once(_size, (cut_init_func_t) _setup, (cut_exit_func_t) _teardown)
+
+/**
+ * @return the data buffer set up by the running test's suite with
+ * CUT_CONFIG_SUITE_ONCE(), or NULL if it has none.
+ */
+void* cut_suite_data(void);
+
 /**
  * Called from the suite's installer, this macro adds a test for the function
  * with the given @a _name.
  */
 #define CUT_ADD_TEST(_name)  cut_add_test( # _name, (cut_test_func_t) _name)
 
+/**
+ * Called from the suite's installer, this macro sets a time limit of
+ * @a _msec milliseconds for each of the suite's tests, overriding
+ * cut_timeout_msec. A value of 0 restores the default.
+ */
+#define CUT_CONFIG_TIMEOUT(_msec)  cut_config_timeout(_msec)
+
+/**
+ * As CUT_ADD_TEST(), but with a time limit of @a _msec milliseconds for this
+ * test, overriding the suite's limit.
+ */
+#define CUT_ADD_TEST_TIMEOUT(_name,_msec)  cut_add_test_timeout( # _name, (cut_test_func_t) _name, _msec)
+
+/**
+ * Called from the suite's installer, this macro adds a benchmark for the
+ * function with the given @a _name, which must do the work being measured
+ * as many times as its @a iterations argument says, making assertions as
+ * a test would.
+ *
+ * Normally a benchmark is run as a test with one iteration, so that it is
+ * at least checked. When cut_benchmark is set, its count is calibrated
+ * instead (see cut_benchmark_msec) and then cut_benchmark_runs runs are
+ * timed, and its result line shows the median time per iteration with the
+ * minimum and the median absolute deviation (MAD) of the runs.
+ *
+ * The suite's init function runs once before all of a benchmark's runs and
+ * its exit function once after them, so anything the work uses up must be
+ * restored within the loop.
+ */
+#define CUT_ADD_BENCHMARK(_name)  cut_add_benchmark( # _name, (cut_benchmark_func_t) _name)
+
+/**
+ * As CUT_ADD_BENCHMARK(), but when benchmarks are measured the function is
+ * run on 1, 2, 4... threads at once (see cut_benchmark_threads), each doing
+ * its @a iterations on its own data: the test's data for the first thread,
+ * and a buffer that the suite's init and exit functions prepare and finish
+ * on each other thread. Shared state, such as the structure under test,
+ * belongs in the suite's once-per-suite data (see cut_suite_data()).
+ *
+ * The threads start each run together from a barrier, and a run lasts
+ * until the last of them is done. The result line is followed by the
+ * operations per second at each thread count and the efficiency: that
+ * rate over the thread count, relative to the same for the first count.
+ * The statistics on the result line, and those compared with or saved as a
+ * baseline, are the wall time per operation at the last count.
+ */
+#define CUT_ADD_SCALING_BENCHMARK(_name)  cut_add_scaling_benchmark( # _name, (cut_benchmark_func_t) _name)
+
+/**
+ * @return the index of the calling thread in a scaling benchmark's run,
+ * from 0 (the test's own thread) to cut_benchmark_thread_count() - 1; 0
+ * outside of one. It may be called from the suite's init function.
+ */
+int cut_benchmark_thread(void);
+
+/**
+ * @return the number of threads running the calling thread's scaling
+ * benchmark, or 1 outside of one.
+ */
+int cut_benchmark_thread_count(void);
+
+/**
+ * A test registered with CUT_TEST(), found by cut_run() without any
+ * installer. It is constant data; nothing is done for it at startup.
+ */
+typedef struct cut_static_test_s
+{
+  const char* suite;
+  const char* name;
+  cut_test_func_t func;
+  unsigned timeout_msec;
+  const char* file;
+  int line;
+} cut_static_test_t;
+
+/**
+ * Links a static test into a list when its compiler or object format
+ * provides no way for cut to find the test's descriptor by itself. Used by
+ * the constructor that CUT_TEST() then emits.
+ */
+typedef struct cut_static_link_s
+{
+  const cut_static_test_t* test;
+  struct cut_static_link_s* next;
+} cut_static_link_t;
+
+void cut_register_static_test(cut_static_link_t* link);
+
+/**
+ * Non-zero when CUT_TEST() places a pointer to each descriptor in the
+ * "cut_tests" section, whose bounds the ELF linker provides as
+ * __start_cut_tests and __stop_cut_tests. Elsewhere a constructor links the
+ * descriptor into a list before main() runs.
+ */
+#if defined(__GNUC__) && defined(__ELF__)
+#define CUT_STATIC_SECTION 1
+#else
+#define CUT_STATIC_SECTION 0
+#endif
+
+#define CUT_STATIC_LINK_FUNC(_d)                          \
+  static void _d ## _link(void)                           \
+  {                                                       \
+    static cut_static_link_t link = { &_d, NULL };        \
+    cut_register_static_test(&link);                      \
+  }
+
+#if CUT_STATIC_SECTION
+#define CUT_STATIC_REGISTER(_d) \
+  static const cut_static_test_t* const _d ## _ptr __attribute__((used, section("cut_tests"))) = &_d;
+#elif defined(__GNUC__)
+#define CUT_STATIC_REGISTER(_d) \
+  static void _d ## _link(void) __attribute__((constructor)); \
+  CUT_STATIC_LINK_FUNC(_d)
+#elif defined(_MSC_VER)
+#define CUT_STATIC_REGISTER(_d)  \
+  CUT_STATIC_LINK_FUNC(_d)       \
+  __pragma(section(".CRT$XCU", read)) \
+  __declspec(allocate(".CRT$XCU")) static void (*_d ## _init)(void) = _d ## _link;
+#elif defined(__cplusplus)
+#define CUT_STATIC_REGISTER(_d) \
+  CUT_STATIC_LINK_FUNC(_d)      \
+  static const int _d ## _init = (_d ## _link(), 0);
+#else
+#error "cut: CUT_TEST() needs GCC, Clang, MSVC or a C++ compiler"
+#endif
+
+/**
+ * Defines and registers a test in @a _suite named @a _name, with no
+ * installer function. Follow it with the body of the test, which receives
+ * the test's data buffer as @a data:
+ *
+ * @code
+ * CUT_TEST(math, add)
+ * {
+ *   CUT_ASSERT_INT(4, 2 + 2);
+ *   return CUT_RESULT_PASS;
+ * }
+ * @endcode
+ *
+ * cut_run() finds every such test in the program and installs them, grouped
+ * by suite and in source order within a file, after any suites installed
+ * with CUT_INSTALL_SUITE(). A test in a static library is only found if its
+ * object file is linked in for some other reason.
+ */
+#define CUT_TEST(_suite,_name)  CUT_TEST_TIMEOUT(_suite,_name,0)
+
+/**
+ * As CUT_TEST(), but with a time limit of @a _msec milliseconds.
+ */
+#define CUT_TEST_TIMEOUT(_suite,_name,_msec)                                  \
+  static cut_result_t cut_test_ ## _suite ## _ ## _name(void* data);         \
+  static const cut_static_test_t cut_static_ ## _suite ## _ ## _name =       \
+  {                                                                           \
+    # _suite, # _name, cut_test_ ## _suite ## _ ## _name, _msec, __FILE__, __LINE__ \
+  };                                                                          \
+  CUT_STATIC_REGISTER(cut_static_ ## _suite ## _ ## _name)                   \
+  static cut_result_t cut_test_ ## _suite ## _ ## _name(void* data)
+
 /**
  * Processes command line arguments for cut-specific settings. If an error is
  * found in a cut-specific setting then a message is printed to stderr and
@@ -135,6 +346,8 @@ void cut_usage(FILE* file);
  * run and from that point on tests are added to the list with this and each
  * subsequent call to cut_include_test().
  *
+ * @a substring may also be a pattern, as for cut_select_tests().
+ *
  * @param substring - string to find within a full test name ("suite.test")
  * for including that test when cut_run() is called.
  *
@@ -146,6 +359,34 @@ void cut_usage(FILE* file);
  */
 int cut_include_test(const char* substring);
 
+/**
+ * Set suite.tests that match @a pattern NOT to run, as for a pattern with a
+ * leading '!' given to cut_select_tests().
+ *
+ * @return the number of tests matched by @a pattern.
+ */
+int cut_exclude_test(const char* pattern);
+
+/**
+ * Select the tests to run with @a count @a patterns at once. Each full test
+ * name is scanned only once, however many patterns there are, so this is
+ * much faster than calling cut_include_test() for each of many patterns.
+ *
+ * A pattern is a substring of the full name, as for cut_include_test(),
+ * unless it contains '*' (any characters) or '?' (any one character), in
+ * which case it must match the whole name. A leading '^' or trailing '$'
+ * anchors the pattern to the start or end of the name. A leading '!' makes
+ * the pattern exclude the tests it matches instead, and an excluded test
+ * stays excluded even if another pattern includes it.
+ *
+ * @param matched - if not NULL, an array of @a count that receives the
+ * number of tests matched by each pattern.
+ *
+ * @return CUT_RESULT_PASS if every pattern matched at least one test,
+ * CUT_RESULT_FAIL if one did not, or CUT_RESULT_ERROR if out of memory.
+ */
+cut_result_t cut_select_tests(const char* const* patterns, size_t count, int* matched);
+
 /**
  * Run the entire suite - all tests that are currently enabled.
  *
@@ -160,6 +401,25 @@ int cut_include_test(const char* substring);
  */
 cut_result_t cut_run(int print_summary);
 
+/**
+ * Run the entire suite as cut_run() does, but on a pool of @a jobs worker
+ * threads. Each worker has its own test state, its own copy of the suite's
+ * data buffer and its own counters, which are merged into the summary once
+ * all tests have run. Output for each test is printed as a unit when the
+ * test completes, so tests are reported in order of completion.
+ *
+ * Tests run concurrently, so tests in a parallel run must not depend on
+ * unsynchronized shared state.
+ *
+ * @param print_summary - if non-zero, a summary will be printed to stdout.
+ *
+ * @param jobs - number of worker threads; 1 runs serially on the calling
+ * thread and 0 uses one thread per CPU.
+ *
+ * @return the same as cut_run().
+ */
+cut_result_t cut_run_parallel(int print_summary, int jobs);
+
 /**
  * Flags for results.
  */
@@ -193,6 +453,73 @@ extern const char* cut_name_delimiter;
  */
 #define CUT_PRINT_INIT_CASES_DEFAULT    0
 
+/**
+ * The default value used for whether or not to print the CPU time, context
+ * switches and page faults of each test.
+ */
+#define CUT_PRINT_RESOURCES_DEFAULT     0
+
+/**
+ * The default value used for whether or not to count hardware events in
+ * each test.
+ */
+#define CUT_PERF_COUNTERS_DEFAULT       0
+
+/**
+ * The default value used for whether or not to count each test's heap
+ * allocations.
+ */
+#define CUT_TRACK_ALLOCATIONS_DEFAULT   0
+
+/**
+ * The default number of worker threads used by cut_run().
+ */
+#define CUT_JOBS_DEFAULT                1
+
+/**
+ * The default value used for whether or not to run each test in its own
+ * process.
+ */
+#define CUT_ISOLATE_DEFAULT             0
+
+/**
+ * The default value used for whether or not to fork isolated tests from a
+ * forkserver.
+ */
+#define CUT_FORKSERVER_DEFAULT          0
+
+/**
+ * The default values used for whether or not to run the tests that failed
+ * in the last run first, or only those tests.
+ */
+#define CUT_FAILED_FIRST_DEFAULT        0
+#define CUT_FAILED_ONLY_DEFAULT         0
+
+/**
+ * The default time limit for each test in milliseconds (0 is no limit).
+ */
+#define CUT_TIMEOUT_DEFAULT             0
+
+/**
+ * The default value used for whether or not to report the busiest
+ * assertion sites of each test.
+ */
+#define CUT_PROFILE_ASSERTIONS_DEFAULT  0
+
+/**
+ * The default values used for whether or not to measure benchmarks, the
+ * least time in milliseconds of each timed run, and the number of runs.
+ */
+#define CUT_BENCHMARK_DEFAULT           0
+#define CUT_BENCHMARK_MSEC_DEFAULT      100
+#define CUT_BENCHMARK_RUNS_DEFAULT      5
+
+/**
+ * The default percentage by which a benchmark may be slower than its
+ * baseline before it fails.
+ */
+#define CUT_BENCHMARK_THRESHOLD_DEFAULT 5
+
 /**
  * Set this to remove "_test" or "test" from the end of suite and test names
  * (not case-sensitive).
@@ -225,6 +552,224 @@ extern int cut_print_case_flags;
  */
 extern int cut_print_init_cases;
 
+/**
+ * Set this to non-zero to follow each test's result line with its elapsed
+ * time in nanoseconds (the line itself shows microseconds), the user and
+ * system CPU time it used, its voluntary and involuntary context switches,
+ * and its minor and major page faults. A test that takes much more wall
+ * time than CPU time is waiting on something. The counts are for the
+ * test's own thread where the system can tell (Linux), and otherwise for
+ * the whole process, which only makes sense for serial runs.
+ */
+extern int cut_print_resources;
+
+/**
+ * Set this to non-zero to count CPU cycles, instructions, branch misses, L1
+ * data cache misses and last-level cache misses (Linux only, through
+ * perf_event_open()). The counts of each test's init, test and exit phases
+ * are kept apart. The test phase's counts follow the test's result line -
+ * for a benchmark, its counts per iteration over the timed runs - and the
+ * totals of each phase follow the summary.
+ *
+ * Only events in user space are counted, which most systems allow without
+ * privileges. If the kernel forbids even that, a note is printed and the
+ * tests run without counters. Instruction counts hardly change with the
+ * load on the machine, so they show a regression where times are too
+ * noisy to.
+ */
+extern int cut_perf_counters;
+
+/**
+ * Set this to non-zero to count the heap allocations made on each test's
+ * thread from its init function through its exit function, and to follow
+ * its result line with how many there were, how many bytes they asked for,
+ * the most bytes that were live at once, and how many (and how many bytes)
+ * were never freed. A test that starts to allocate more is often the first
+ * sign of a performance regression. Allocations made by cut itself, or by
+ * other threads, are not counted.
+ *
+ * Needs CUT_ALLOC_HOOKS; otherwise a note is printed and nothing is
+ * counted.
+ */
+extern int cut_track_allocations;
+
+/**
+ * Non-zero when cut.c replaces malloc(), calloc(), realloc(), free() and
+ * the aligned allocators to count allocations, and ccut.cc replaces
+ * operator new and delete to use them. Replacing the allocator affects
+ * the whole program, so it is off unless cut.c (and ccut.cc, for C++) are
+ * built with CUT_ALLOC_HOOKS defined as 1. Outside of a counted region the
+ * replacements cost one test of a thread-local variable.
+ *
+ * The hooks need the GNU C library, which lets a program replace the
+ * allocator and still call its own (__libc_malloc() and so on), and a
+ * dynamically linked program: a static one gets the library's malloc()
+ * as well. Elsewhere, and under sanitizers that bring their own allocator,
+ * they stay off even when asked for.
+ */
+#if !defined(CUT_ALLOC_HOOKS)
+#define CUT_ALLOC_HOOKS 0
+#endif
+
+#if CUT_ALLOC_HOOKS
+#if !defined(__GLIBC__) || defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#undef CUT_ALLOC_HOOKS
+#define CUT_ALLOC_HOOKS 0
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#undef CUT_ALLOC_HOOKS
+#define CUT_ALLOC_HOOKS 0
+#endif
+#endif
+#endif
+
+/**
+ * Number of worker threads used by cut_run(). A value of 1 runs the tests
+ * serially on the calling thread; 0 uses one thread per CPU. See
+ * cut_run_parallel().
+ */
+extern int cut_jobs;
+
+/**
+ * Set this to run each test in its own child process, forked from the
+ * process calling cut_run(). Up to cut_jobs tests run at once. The parent
+ * collects each test's result, assertion counts and printed cases over a
+ * pipe, so a test that crashes is reported as an ERROR naming the signal
+ * that killed it, and the run continues with the remaining tests. Not
+ * supported on Windows.
+ */
+extern int cut_isolate;
+
+/**
+ * Set this to run each test in its own child process as with cut_isolate,
+ * but with every child forked from a forkserver rather than from the
+ * process running cut_run().
+ *
+ * The call to cut_run() is the "ready" checkpoint: anything the program has
+ * done before then - loading models, building lookup tables - is captured
+ * once when the forkserver is started. Each selected test then runs in a
+ * copy-on-write fork of that warmed-up state, so it pays for neither the
+ * startup work nor anything the parent does while collecting results. Not
+ * supported on Windows.
+ */
+extern int cut_forkserver;
+
+/**
+ * Suffix added to the program name to form the default history file name.
+ */
+#define CUT_HISTORY_SUFFIX              ".cut-history"
+
+/**
+ * Name of the file in which the duration of each test is kept from one run
+ * to the next, or NULL (the default) to keep no history. cut_run() reads it
+ * before running and rewrites it afterwards; entries for tests that are not
+ * registered are kept.
+ *
+ * When tests run in parallel, they are started longest-expected-first from
+ * a shared queue, so a slow test does not start last and hold up the end of
+ * the run. A test without history is expected to take the average time of
+ * the other tests in its suite.
+ */
+extern const char* cut_history_file;
+
+/**
+ * The history file also records the result of each test. Set
+ * cut_failed_first to run the tests that failed (FAIL or ERROR) in their
+ * last run before the others, and cut_failed_only to run only those tests;
+ * the rest are excluded as with cut_include_test(). If no test failed last
+ * time, cut_failed_only runs every test. Either one keeps history in the
+ * default file (see -history) if cut_history_file is not set.
+ */
+extern int cut_failed_first;
+extern int cut_failed_only;
+
+/**
+ * Set to count the assertions made at each file:line site in each test,
+ * with the time since the test's previous assertion, and to print the
+ * busiest and most failing sites of each test after the run. Sites are
+ * keyed by the address of their file name, so nothing is hashed as a
+ * string. Passes of fast assertions (CUT_FAST_ASSERT_xxx()) are not seen,
+ * nor are tests run in their own processes.
+ */
+extern int cut_profile_assertions;
+
+/**
+ * Set cut_benchmark to measure the benchmarks added with
+ * CUT_ADD_BENCHMARK() rather than run each one once as a test.
+ *
+ * A benchmark's iteration count starts at 1 and grows, from the time each
+ * run took, until a run takes at least cut_benchmark_msec milliseconds;
+ * these runs also warm it up. cut_benchmark_runs more runs of that count
+ * are then timed. The median and MAD are robust to the odd run slowed by
+ * an interrupt or a page fault. Benchmarks run on other threads (see
+ * cut_jobs) or processes compete for the CPU, so measure with one job.
+ */
+extern int cut_benchmark;
+extern int cut_benchmark_msec;
+extern int cut_benchmark_runs;
+
+/**
+ * Name of a file holding the timed runs of earlier benchmark measurements,
+ * or NULL (the default) to compare against none. Each benchmark measured
+ * in this run that has runs in the file is compared with them, and the
+ * change in its median is shown on its result line with a p-value.
+ *
+ * The comparison is a one-sided Mann-Whitney U test of whether the runs
+ * are slower than the baseline runs made cut_benchmark_threshold percent
+ * slower. Where that is so at the 5% level, the benchmark FAILs, so the
+ * run's result can gate a merge. The test uses only the order of the runs,
+ * so one very slow run cannot carry it, and it needs no more runs than the
+ * baseline's and this run's to reach a verdict: with 5 of each, a
+ * consistent slowdown beyond the threshold is enough.
+ */
+extern const char* cut_benchmark_baseline;
+extern int cut_benchmark_threshold;
+
+/**
+ * Name of a file to which the timed runs of the benchmarks measured in
+ * this run are written, or NULL (the default). The file is in the form read
+ * through cut_benchmark_baseline, and may be the same file. Benchmarks
+ * that it holds but that were not measured are kept.
+ *
+ * Setting either of cut_benchmark_baseline or cut_benchmark_save measures
+ * benchmarks, as if cut_benchmark were set.
+ */
+extern const char* cut_benchmark_save;
+
+/**
+ * Comma-separated thread counts at which scaling benchmarks are measured,
+ * such as "1,2,4,8", or NULL (the default) for the powers of two below the
+ * number of CPUs followed by that number.
+ */
+extern const char* cut_benchmark_threads;
+
+/**
+ * Time limit for each test in milliseconds, or 0 (the default) for none.
+ * Suites and tests can set their own limits with CUT_CONFIG_TIMEOUT() and
+ * CUT_ADD_TEST_TIMEOUT().
+ *
+ * A test that runs past its limit is reported as an ERROR along with how
+ * long it ran. Isolated tests (see cut_isolate) are killed and the run goes
+ * on with the next test. Otherwise the hung test cannot be stopped safely,
+ * so the program exits with CUT_RESULT_ERROR after reporting it.
+ */
+extern int cut_timeout_msec;
+
+/**
+ * Set these to split the registered tests into cut_shard_count disjoint
+ * shards and run only shard cut_shard_index (counting from 0), for example
+ * to spread one test program across several machines. Together the shards
+ * cover every test. Tests in other shards are neither run nor reported.
+ *
+ * A test's shard comes from a stable hash of its full name ("suite.test"),
+ * so it is the same on every machine. When cut_history_file is set and has
+ * durations, the selected tests are instead dealt into shards of about
+ * equal total duration. Every machine must then start from an identical copy
+ * of the history file, since each run rewrites it.
+ */
+extern int cut_shard_index;
+extern int cut_shard_count;
+
 /**
  * Registers the result of an assertion.
  * All of the other assertion functions and macros end up calling this.
@@ -250,6 +795,15 @@ cut_result_t cut_assert(const char* file,
 #define CUT_GNU_ATTRIBUTE(...)
 #endif
 
+/**
+ * Storage class of a variable with a copy for each thread.
+ */
+#if defined(_WIN32)
+#define CUT_THREAD_LOCAL  __declspec(thread)
+#else
+#define CUT_THREAD_LOCAL  __thread
+#endif
+
 /**
  * Allows freely formatted printing of the message associated with the
  * assertion.
@@ -357,6 +911,205 @@ cut_result_t cut_assert_memory(const char* file, int line, const void* proper, c
 #define CUT_ASSERT_NULL(_a)                CUT_FL_ASSERT_NULL(__FILE__,__LINE__, (_a))
 #define CUT_ASSERT_NONNULL(_a)             CUT_FL_ASSERT_NONNULL(__FILE__,__LINE__, (_a))
 
+/*
+ * Fast assertions, for checks made many times in inner loops. The condition
+ * is evaluated inline and a pass only adds to a per-thread count, which is
+ * added to the summary when the test returns. Only a failure, or a pass
+ * that -show-pass-cases wants printed, calls into the library, passing a
+ * static descriptor of the assertion's site. Each argument is evaluated
+ * exactly once.
+ */
+
+/**
+ * Where a fast assertion is made, and its text.
+ */
+typedef struct cut_site_s
+{
+  const char* file;
+  int line;
+  const char* text;
+} cut_site_t;
+
+/**
+ * Number of fast assertions passed on this thread since the library last
+ * collected them.
+ */
+extern CUT_THREAD_LOCAL unsigned int cut_fast_passes;
+
+/**
+ * Makes an assertion of @a condition for the fast assertion at @a site;
+ * the out-of-line path of CUT_FAST_ASSERT().
+ */
+cut_result_t cut_assert_site(const cut_site_t* site, int condition);
+
+/**
+ * The out-of-line paths of the typed fast assertions, which make the same
+ * assertions as cut_assert_int_in(), cut_assert_pointer() and
+ * cut_assert_double_in() for the fast assertion at @a site.
+ */
+cut_result_t cut_assert_site_int_in(const cut_site_t* site, cut_int_t lo, cut_int_t hi, cut_int_t actual);
+cut_result_t cut_assert_site_pointer(const cut_site_t* site, const void* proper, const void* actual);
+cut_result_t cut_assert_site_double_in(const cut_site_t* site, double lo, double hi, double actual);
+
+#if defined(__GNUC__)
+#define CUT_LIKELY(_x)     __builtin_expect(!!(_x), 1)
+#else
+#define CUT_LIKELY(_x)     (_x)
+#endif
+
+/**
+ * Counts a pass of the fast assertion at the site @a _text if @a _ok and
+ * passes need not be printed; otherwise returns from the test with the
+ * result of @a _slow unless it is a pass. The site is _cut_site.
+ */
+#define CUT_FAST_CHECK(_ok,_text,_slow)                                       \
+  do {                                                                        \
+    static const cut_site_t _cut_site = { __FILE__, __LINE__, _text };        \
+    if (CUT_LIKELY(_ok) && CUT_LIKELY(!(cut_print_case_flags & CUT_FLAG_PASS))) { \
+      cut_fast_passes++;                                                      \
+    } else {                                                                  \
+      CUT_RETURN(_slow);                                                      \
+    }                                                                         \
+  } while (0)
+
+#define CUT_FAST_ASSERT(_cond)                                                \
+  do {                                                                        \
+    int _cut_ok = (_cond) ? 1 : 0;                                            \
+    CUT_FAST_CHECK(_cut_ok, # _cond, cut_assert_site(&_cut_site, _cut_ok));  \
+  } while (0)
+
+#define CUT_FAST_ASSERT_INT_IN(_lo,_hi,_a)                                    \
+  do {                                                                        \
+    cut_int_t _cut_lo = (cut_int_t) (_lo);                                    \
+    cut_int_t _cut_hi = (cut_int_t) (_hi);                                    \
+    cut_int_t _cut_a = (cut_int_t) (_a);                                      \
+    CUT_FAST_CHECK(((_cut_lo <= _cut_a) && (_cut_a <= _cut_hi)) ||            \
+                   ((_cut_hi <= _cut_a) && (_cut_a <= _cut_lo)), # _a,        \
+                   cut_assert_site_int_in(&_cut_site, _cut_lo, _cut_hi, _cut_a));    \
+  } while (0)
+
+#define CUT_FAST_ASSERT_INT(_p,_a)                                            \
+  do {                                                                        \
+    cut_int_t _cut_p = (cut_int_t) (_p);                                      \
+    cut_int_t _cut_a = (cut_int_t) (_a);                                      \
+    CUT_FAST_CHECK(_cut_p == _cut_a, # _a,                                    \
+                   cut_assert_site_int_in(&_cut_site, _cut_p, _cut_p, _cut_a));      \
+  } while (0)
+
+#define CUT_FAST_ASSERT_POINTER(_p,_a)                                        \
+  do {                                                                        \
+    const void* _cut_p = (_p);                                                \
+    const void* _cut_a = (_a);                                                \
+    CUT_FAST_CHECK(_cut_p == _cut_a, # _a,                                    \
+                   cut_assert_site_pointer(&_cut_site, _cut_p, _cut_a));             \
+  } while (0)
+
+#define CUT_FAST_ASSERT_DOUBLE_IN(_lo,_hi,_a)                                 \
+  do {                                                                        \
+    double _cut_lo = (_lo);                                                   \
+    double _cut_hi = (_hi);                                                   \
+    double _cut_a = (_a);                                                     \
+    CUT_FAST_CHECK(((_cut_lo <= _cut_a) && (_cut_a <= _cut_hi)) ||            \
+                   ((_cut_hi <= _cut_a) && (_cut_a <= _cut_lo)), # _a,        \
+                   cut_assert_site_double_in(&_cut_site, _cut_lo, _cut_hi, _cut_a)); \
+  } while (0)
+
+#define CUT_FAST_ASSERT_DOUBLE_NEAR(_p,_a,_eps)                               \
+  do {                                                                        \
+    double _cut_p = (_p);                                                     \
+    double _cut_eps = (_eps);                                                 \
+    CUT_FAST_ASSERT_DOUBLE_IN(_cut_p * (1.0 - _cut_eps), _cut_p * (1.0 + _cut_eps), (_a)); \
+  } while (0)
+
+#define CUT_FAST_ASSERT_DOUBLE(_p,_a)        CUT_FAST_ASSERT_DOUBLE_NEAR((_p),(_a), CUT_EPSILON)
+#define CUT_FAST_ASSERT_NULL(_a)             CUT_FAST_ASSERT((_a) == NULL)
+#define CUT_FAST_ASSERT_NONNULL(_a)          CUT_FAST_ASSERT((_a) != NULL)
+
+/*
+ * Allocation budgets. These run @a _code and fail if it made more than
+ * @a _n heap allocations (counting each call to malloc(), calloc(),
+ * realloc() or, from C++ with ccut.cc, new) or asked for more than
+ * @a _bytes bytes, on the calling thread. A failure gives the counts and
+ * where the first allocation past the budget was called from, so a hot
+ * path that must never allocate can be held to it with
+ * CUT_ASSERT_NO_ALLOCS(). Budgets may be nested.
+ *
+ * The counts come from the hooks of CUT_ALLOC_HOOKS. Without them the
+ * assertion is reported as a SKIP and the test goes on.
+ */
+#define CUT_ALLOC_UNLIMITED  (~0ULL)
+
+int cut_alloc_region_begin(unsigned long long max_count, unsigned long long max_bytes);
+cut_result_t cut_assert_alloc_region(const char* file, int line, int region, const char* code);
+
+#define CUT_FL_ASSERT_ALLOCS(_f,_l,_n,_bytes,_code)                           \
+  do {                                                                        \
+    int _cut_region = cut_alloc_region_begin((_n), (_bytes));                 \
+    _code ;                                                                   \
+    CUT_RETURN(cut_assert_alloc_region(_f,_l, _cut_region, # _code));         \
+  } while (0)
+
+#define CUT_ASSERT_ALLOCS_LE(_n,_code)           CUT_FL_ASSERT_ALLOCS(__FILE__,__LINE__, (_n), CUT_ALLOC_UNLIMITED, _code)
+#define CUT_ASSERT_ALLOC_BYTES_LE(_bytes,_code)  CUT_FL_ASSERT_ALLOCS(__FILE__,__LINE__, CUT_ALLOC_UNLIMITED, (_bytes), _code)
+#define CUT_ASSERT_NO_ALLOCS(_code)              CUT_ASSERT_ALLOCS_LE(0, _code)
+
+/*
+ * Latency histograms. A cut_histogram_t records unsigned values, such as
+ * the nanoseconds each request took, in buckets that grow with the value,
+ * HDR-style: each power of two is split into 2^CUT_HISTOGRAM_SUB_BITS
+ * buckets, so a value is known to within 1 part in 64, and the memory used
+ * is fixed no matter how many values are recorded. The smallest and
+ * largest values and the sum are kept exactly. Values at or above
+ * 2^CUT_HISTOGRAM_MAX_BITS all share the last bucket.
+ *
+ * A histogram allocates nothing and is not locked; give each thread its own
+ * and combine them with cut_histogram_merge(). Zero it (or call
+ * cut_histogram_clear()) before use.
+ */
+#define CUT_HISTOGRAM_SUB_BITS   6
+#define CUT_HISTOGRAM_MAX_BITS   40
+#define CUT_HISTOGRAM_BUCKETS    ((CUT_HISTOGRAM_MAX_BITS - CUT_HISTOGRAM_SUB_BITS + 1) << CUT_HISTOGRAM_SUB_BITS)
+
+typedef struct cut_histogram_s
+{
+  unsigned long long count;
+  unsigned long long min;
+  unsigned long long max;
+  double sum;
+  unsigned int bucket[CUT_HISTOGRAM_BUCKETS];
+} cut_histogram_t;
+
+void cut_histogram_clear(cut_histogram_t* histogram);
+void cut_histogram_record(cut_histogram_t* histogram, unsigned long long value);
+void cut_histogram_merge(cut_histogram_t* to, const cut_histogram_t* from);
+
+/**
+ * @return the value below or at which @a percentile percent of the values
+ * in @a histogram fall, rounded up to the top of its bucket, so that it is
+ * never understated; 0 if the histogram is empty. Percentile 0 gives the
+ * smallest value and 100 the largest, exactly.
+ */
+unsigned long long cut_histogram_percentile(const cut_histogram_t* histogram, double percentile);
+
+/**
+ * Prints a table of @a histogram's percentiles to @a file, each line
+ * starting with @a indent.
+ */
+void cut_histogram_print(FILE* file, const cut_histogram_t* histogram, const char* indent);
+
+/**
+ * Asserts that @a percentile percent of the values in @a histogram are at
+ * most @a max. A failure prints the whole percentile table. @a text names
+ * the histogram.
+ */
+cut_result_t cut_assert_percentile(const char* file, int line, const cut_histogram_t* histogram, double percentile,
+                                   unsigned long long max, const char* text);
+
+#define CUT_FL_ASSERT_PERCENTILE_LE(_f,_l,_h,_p,_max)  CUT_RETURN(cut_assert_percentile(_f,_l, (_h), (_p), (_max), # _h))
+#define CUT_ASSERT_PERCENTILE_LE(_h,_p,_max)           CUT_FL_ASSERT_PERCENTILE_LE(__FILE__,__LINE__, _h, (_p), (_max))
+#define CUT_ASSERT_MEDIAN_LE(_h,_max)                  CUT_ASSERT_PERCENTILE_LE(_h, 50.0, (_max))
+#define CUT_ASSERT_MAX_LE(_h,_max)                     CUT_ASSERT_PERCENTILE_LE(_h, 100.0, (_max))
+
 /**
  * Use this to end the current test with the given result (just the short
  * result name, not with CUT_RESULT_). For example, CUT_TEST_END(PASS).
@@ -11,6 +11,8 @@
 #else
 #include <unistd.h>
 #endif
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "cut.h"
@@ -60,6 +62,78 @@ static cut_result_t fail_me(void)
     CUT_TEST_PASS();
 }
 
+/**
+ * For checks made many times in a loop, CUT_FAST_ASSERT_xxx() compares
+ * inline and only counts a pass.
+ */
+static cut_result_t fast_loop(void)
+{
+    int squares[100];
+    int last = g_simple_force_failure ? 50 : 99;
+    int i = 0;
+    for (i = 0; i < 100; i++) {
+        squares[i] = i * i;
+    }
+    for (i = 0; i < 100; i++) {
+        CUT_FAST_ASSERT_INT(i * i, squares[i]);
+        CUT_FAST_ASSERT_INT_IN(0, last * last, squares[i]);
+        CUT_FAST_ASSERT_DOUBLE((double) i * i, (double) squares[i]);
+        CUT_FAST_ASSERT(squares[i] >= i);
+    }
+    CUT_TEST_PASS();
+}
+
+static char* copy_string(const char* text)
+{
+    size_t size = strlen(text) + 1;
+    char* copy = (char*) malloc(size);
+    if (NULL != copy) {
+        memcpy(copy, text, size);
+    }
+    return copy;
+}
+
+/**
+ * CUT_ASSERT_ALLOCS_LE() puts a budget on the heap allocations of one piece
+ * of code. Builds that count no allocations skip it.
+ */
+static cut_result_t alloc_budget(void)
+{
+    size_t length = 0;
+    char* copy = NULL;
+    CUT_ASSERT_NO_ALLOCS(length = strlen("example"));
+    CUT_ASSERT_ALLOCS_LE(g_simple_force_failure ? 0 : 1, copy = copy_string("example"));
+    CUT_ASSERT_STRING("example", copy);
+    CUT_ASSERT_INT(7, length);
+    free(copy);
+    CUT_TEST_PASS();
+}
+
+/**
+ * A cut_histogram_t holds many values in fixed space, to check the tail of
+ * their distribution rather than their average. Here the values are the
+ * numbers 1 to 1000, recorded into two histograms that are then merged.
+ */
+static cut_result_t histogram(void)
+{
+    cut_histogram_t odd;
+    cut_histogram_t even;
+    cut_histogram_t all;
+    unsigned long long i = 0;
+    cut_histogram_clear(&odd);
+    cut_histogram_clear(&even);
+    cut_histogram_clear(&all);
+    for (i = 1; i <= 1000; i++) {
+        cut_histogram_record((i & 1) ? &odd : &even, i);
+    }
+    cut_histogram_merge(&all, &odd);
+    cut_histogram_merge(&all, &even);
+    CUT_ASSERT_MEDIAN_LE(&all, 510);
+    CUT_ASSERT_PERCENTILE_LE(&all, 99.0, g_simple_force_failure ? 900 : 1000);
+    CUT_ASSERT_MAX_LE(&all, 1000);
+    CUT_TEST_PASS();
+}
+
 void example_test(void)
 {
     CUT_ADD_TEST(one);
@@ -67,4 +141,18 @@ void example_test(void)
     CUT_ADD_TEST(three_internal_skip);
     CUT_ADD_TEST(four);
     CUT_ADD_TEST(fail_me);
+    CUT_ADD_TEST(fast_loop);
+    CUT_ADD_TEST(alloc_budget);
+    CUT_ADD_TEST(histogram);
+}
+
+/*
+ * A test can also register itself, with no installer function. cut_run()
+ * finds it and puts it in the suite "example_static".
+ */
+CUT_TEST(example_static, registered)
+{
+    (void) data;
+    CUT_ASSERT_INT(4, 2 + 2);
+    CUT_TEST_PASS();
 }
@@ -31,10 +31,14 @@ static void usage(FILE* f, int exit_code) {
 int main(int argc, char* argv[])
 {
     int i = 0;
-    cut_parse_command_line(&argc, argv);
+    if (CUT_RESULT_PASS != cut_parse_command_line(&argc, argv)) {
+        usage(stderr, 1);
+    }
 
     CUT_INSTALL_SUITE(example_test);
     CUT_INSTALL_SUITE(example_with_init_test);
+    CUT_INSTALL_SUITE(example_with_once_test);
+    CUT_INSTALL_SUITE(example_with_snapshot_test);
 
     for (i = 1; i < argc; ++i) {
         if ((0 == strcmp(argv[i], "-h")) || (0 == strcmp(argv[i], "-help"))) {
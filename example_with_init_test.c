@@ -71,6 +71,34 @@ static cut_result_t product_test(test_t* test)
     CUT_TEST_PASS();
 }
 
+/**
+ * A benchmark gets an iteration count. The file opened by test_init() is
+ * used by every iteration, so each one starts by rewinding it.
+ */
+static cut_result_t sum_benchmark(test_t* test, size_t iterations)
+{
+    size_t i = 0;
+    for (i = 0; i < iterations; i++) {
+        int sum = 0;
+        int val = 0;
+        rewind(test->file);
+        while (fscanf(test->file, "%d", &val) == 1) {
+            sum += val;
+        }
+        CUT_ASSERT_INT(143, sum);
+    }
+    CUT_TEST_PASS();
+}
+
+/**
+ * The same work on several threads at once. Each thread gets its own test_t
+ * from test_init(), so each reads its own open file.
+ */
+static cut_result_t sum_scaling_benchmark(test_t* test, size_t iterations)
+{
+    return sum_benchmark(test, iterations);
+}
+
 /**
  * The suite installer function calls CUT_CONFIG_SUITE() with the size of the
  * test data blob to use, the test initializer (test_init()) and test
@@ -81,4 +109,112 @@ void example_with_init_test(void)
     CUT_CONFIG_SUITE(sizeof(test_t), test_init, test_exit);
     CUT_ADD_TEST(sum_test);
     CUT_ADD_TEST(product_test);
+    CUT_ADD_BENCHMARK(sum_benchmark);
+    CUT_ADD_SCALING_BENCHMARK(sum_scaling_benchmark);
+}
+
+/**
+ * The numbers in the input file, read once for a whole suite.
+ */
+typedef struct { int count; int value[32]; } numbers_t;
+
+/**
+ * Suite setup function, run once before the first of the suite's tests. As
+ * with test_init(), the tests are meaningless without the input file.
+ */
+static cut_result_t numbers_setup(numbers_t* numbers)
+{
+    FILE* file = NULL;
+#if defined(_WIN32)
+    fopen_s(&file, "input-data.txt", "rt");
+#else
+    file = fopen("input-data.txt", "rt");
+#endif
+    CUT_ASSERT_MESSAGE(file != NULL, "missing \"input-data.txt\"");
+    while ((numbers->count < 32) &&
+           (fscanf(file, "%d", &numbers->value[numbers->count]) == 1)) {
+        numbers->count++;
+    }
+    fclose(file);
+    CUT_TEST_PASS();
+}
+
+static cut_result_t once_sum_test(void)
+{
+    const numbers_t* numbers = (const numbers_t*) cut_suite_data();
+    int sum = 0;
+    int i = 0;
+    for (i = 0; i < numbers->count; i++) {
+        sum += numbers->value[i];
+    }
+    CUT_ASSERT_INT(143, sum);
+    CUT_TEST_PASS();
+}
+
+static cut_result_t once_count_test(void)
+{
+    const numbers_t* numbers = (const numbers_t*) cut_suite_data();
+    int count = numbers->count;
+    if (g_complex_force_failure) {
+        count++;
+    }
+    CUT_ASSERT_INT(10, count);
+    CUT_TEST_PASS();
+}
+
+/**
+ * CUT_CONFIG_SUITE_ONCE() gives the suite a buffer that its setup fills once
+ * and that every test reads with cut_suite_data(). Nothing needs releasing,
+ * so there is no teardown.
+ */
+void example_with_once_test(void)
+{
+    CUT_CONFIG_SUITE_ONCE(sizeof(numbers_t), numbers_setup, NULL);
+    CUT_ADD_TEST(once_sum_test);
+    CUT_ADD_TEST(once_count_test);
+}
+
+/**
+ * A table of plain old data, worked out once and copied for each test.
+ */
+typedef struct { int fibonacci[20]; } table_t;
+
+static cut_result_t table_init(table_t* table)
+{
+    int i = 0;
+    table->fibonacci[0] = 1;
+    table->fibonacci[1] = 1;
+    for (i = 2; i < 20; i++) {
+        table->fibonacci[i] = table->fibonacci[i - 1] + table->fibonacci[i - 2];
+    }
+    CUT_TEST_PASS();
+}
+
+/**
+ * Each test gets its own copy of the table, so changes made here are not
+ * seen by snapshot_fresh_test().
+ */
+static cut_result_t snapshot_change_test(table_t* table)
+{
+    table->fibonacci[19] = 0;
+    CUT_ASSERT_INT(0, table->fibonacci[19]);
+    CUT_TEST_PASS();
+}
+
+static cut_result_t snapshot_fresh_test(table_t* table)
+{
+    int expected = g_complex_force_failure ? 6764 : 6765;
+    CUT_ASSERT_INT(expected, table->fibonacci[19]);
+    CUT_TEST_PASS();
+}
+
+/**
+ * CUT_CONFIG_SUITE_SNAPSHOT() runs table_init() only once; there is nothing
+ * to release, so there is no exit function.
+ */
+void example_with_snapshot_test(void)
+{
+    CUT_CONFIG_SUITE_SNAPSHOT(sizeof(table_t), table_init, NULL);
+    CUT_ADD_TEST(snapshot_change_test);
+    CUT_ADD_TEST(snapshot_fresh_test);
 }